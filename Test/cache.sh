@@ -0,0 +1,11 @@
+BINARY=$1
+shift
+FILE=$1
+shift
+DIR=$(mktemp -d)
+trap 'rm -rf "$DIR"' EXIT
+EXPECTED=$($BINARY $FILE 2>&1) || exit 1
+$BINARY --cache-dir="$DIR" $FILE > /dev/null 2>&1 || exit 1
+ls "$DIR"/*.ast > /dev/null || exit 1
+ACTUAL=$($BINARY --cache-dir="$DIR" $FILE 2>&1) || exit 1
+[ "$EXPECTED" = "$ACTUAL" ]
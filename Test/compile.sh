@@ -0,0 +1,5 @@
+BINARY=$1
+shift
+FILE=$1
+shift
+$BINARY $FILE > /dev/null 2>&1
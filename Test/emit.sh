@@ -0,0 +1,13 @@
+BINARY=$1
+shift
+FILE=$1
+shift
+EXE=$(mktemp)
+trap 'rm -f $EXE' EXIT
+# The program's result is its exit status, which has to match an unoptimized
+# run in the JIT.
+$BINARY --run $FILE > /dev/null 2>&1
+EXPECTED=$?
+$BINARY -O2 -o $EXE $FILE > /dev/null 2>&1 || exit 1
+$EXE
+[ $? -eq $EXPECTED ]
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include "llvm/IR/Verifier.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "ast.hh"
+#include "compiler.hh"
+#include "parser.hh"
+#include "resolve.hh"
+#include "catch.hh"
+
+// Statement i of a StatementList.
+inline AST::Node *statement(AST::Node *list, size_t i) {
+  return llvm::cast<AST::StatementList>(list)->statements[i];
+}
+
+// Compiles source, which must resolve, into s, and checks that the module
+// verifies.
+inline void compile(Compiler::State &s, const std::string &source) {
+  Parser p(source);
+  auto prog = p.parseProgram();
+  REQUIRE(prog != nullptr);
+  REQUIRE(AST::Resolver().resolve(prog));
+  prog->compile(s);
+  REQUIRE_FALSE(llvm::verifyModule(*s.Mod, &llvm::errs()));
+}
@@ -0,0 +1,63 @@
+#include <cstring>
+
+#include "arena.hh"
+#include "ast.hh"
+#include "parser.hh"
+#include "catch.hh"
+
+TEST_CASE("arena allocates and rolls back", "[arena]") {
+  AST::Arena arena;
+
+  SECTION("arena aligns allocations") {
+    arena.allocate(1, 1);
+    auto p = arena.allocate(sizeof(double), alignof(double));
+
+    REQUIRE(reinterpret_cast<uintptr_t>(p) % alignof(double) == 0);
+  }
+
+  SECTION("arena reuses space after a rollback") {
+    auto c = arena.checkpoint();
+    auto first = arena.make<AST::Literal>(1);
+    arena.rollback(c);
+    auto second = arena.make<AST::Literal>(2);
+
+    REQUIRE(static_cast<void *>(first) == static_cast<void *>(second));
+  }
+
+  SECTION("arena rolls back across blocks") {
+    auto keep = arena.make<AST::Literal>(7);
+    auto c = arena.checkpoint();
+    for(int i = 0; i < 10000; ++i) {
+      arena.make<AST::Literal>(i);
+    }
+    arena.rollback(c);
+    auto next = arena.make<AST::Literal>(8);
+
+    REQUIRE(keep->value == 7);
+    REQUIRE(reinterpret_cast<char *>(next) - reinterpret_cast<char *>(keep) < 64);
+  }
+
+  SECTION("arena copies arrays, including ones bigger than a block") {
+    std::vector<int> big(AST::Arena::blockSize, 3);
+    auto copy = arena.copy<int>(big);
+
+    REQUIRE(copy.size() == big.size());
+    REQUIRE(copy.data() != big.data());
+    REQUIRE(copy.back() == 3);
+  }
+}
+
+TEST_CASE("parser reclaims abandoned alternatives", "[arena]") {
+  SECTION("parser result survives backtracking") {
+    std::string source = "f(a + b * c, [x]) < 1 and y = 2";
+    Parser p(source);
+    auto b = llvm::dyn_cast_or_null<AST::BinaryOp>(p.parseBoolean());
+
+    REQUIRE(b != nullptr);
+    auto cmp = llvm::dyn_cast_or_null<AST::BinaryOp>(b->left);
+    auto call = llvm::dyn_cast_or_null<AST::Call>(cmp->left);
+    REQUIRE(call->name.str() == "f");
+    REQUIRE(call->args.size() == 2);
+    REQUIRE(llvm::dyn_cast_or_null<AST::Deref>(call->args[1]) != nullptr);
+  }
+}
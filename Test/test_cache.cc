@@ -0,0 +1,128 @@
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include <unistd.h>
+
+#include "cache.hh"
+#include "parser.hh"
+#include "catch.hh"
+
+static std::string readFile(const std::string &path) {
+  std::ifstream in(path, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(in), {});
+}
+
+static void writeFile(const std::string &path, const std::string &data) {
+  std::ofstream out(path, std::ios::binary);
+  out << data;
+}
+
+static std::vector<std::string> names(const AST::FlatTree &tree) {
+  std::vector<std::string> result;
+  for(auto n : tree.names) {
+    result.push_back(n.str().str());
+  }
+  return result;
+}
+
+TEST_CASE("cached programs reload without parsing", "[cache]") {
+  std::string source = R"(
+    function f(a, b)
+      if a > 1
+        return a
+      else
+        return
+      end
+      while b > a and not b = 0
+        [a] <- f(a - 1, [b]) % 3
+      end
+      return 1
+    end
+
+    x <- f(2, -3)
+  )";
+  Parser p(source);
+  auto prog = p.parseProgram();
+  REQUIRE(prog != nullptr);
+
+  AST::FlatTree tree(prog);
+  auto key = AST::CachedProgram::Key::of(source);
+  auto path = std::string(P_tmpdir) + "/pbc_test_" + std::to_string(getpid()) + ".ast";
+  REQUIRE(AST::CachedProgram::store(path, key, tree));
+
+  SECTION("reloaded program matches the original") {
+    auto cached = AST::CachedProgram::load(path, key);
+    REQUIRE(cached != nullptr);
+
+    AST::FlatTree loaded(cached->program());
+    REQUIRE(loaded.kinds == tree.kinds);
+    REQUIRE(loaded.payloads == tree.payloads);
+    REQUIRE(loaded.links == tree.links);
+    REQUIRE(names(loaded) == names(tree));
+  }
+
+  SECTION("images are named by source hash in a cache directory") {
+    REQUIRE(AST::CachedProgram::path("", "a.pb", key) == "a.pb.ast");
+    REQUIRE(AST::CachedProgram::path("dir", "a.pb", key).size() == 24);
+  }
+
+  SECTION("stale images are ignored") {
+    auto edited = AST::CachedProgram::Key::of(source + "y <- 1\n");
+    REQUIRE(AST::CachedProgram::load(path, edited) == nullptr);
+  }
+
+  SECTION("damaged images are rejected") {
+    auto image = readFile(path);
+
+    writeFile(path, image.substr(0, image.size() - 4));
+    REQUIRE(AST::CachedProgram::load(path, key) == nullptr);
+
+    // Links follow the 48 byte header, the kinds padded to four bytes, the
+    // payloads and the link offsets. The root's first link is to node 1.
+    auto broken = image;
+    auto n = tree.size();
+    auto link = 48 + ((n + 3) & ~size_t(3)) + 4 * n + 4 * (n + 1);
+    REQUIRE(broken[link] == 1);
+    broken[link] = 2;
+    writeFile(path, broken);
+    REQUIRE(AST::CachedProgram::load(path, key) == nullptr);
+
+    image[4]++;
+    writeFile(path, image);
+    REQUIRE(AST::CachedProgram::load(path, key) == nullptr);
+  }
+
+  SECTION("children of the wrong kind are rejected") {
+    // Kinds follow the 48 byte header, one byte per node in preorder. The
+    // node retyped is offset past the last node of kind from. Each change
+    // keeps the arity right, so only the kind check catches it.
+    auto image = readFile(path);
+    auto retype = [&](AST::Kind from, size_t offset, AST::Kind to) {
+      auto broken = image;
+      auto node = std::find(tree.kinds.rbegin(), tree.kinds.rend(), from).base() - 1 - tree.kinds.begin();
+      REQUIRE(broken[48 + node + offset] != char(to));
+      broken[48 + node + offset] = char(to);
+      writeFile(path, broken);
+      REQUIRE(AST::CachedProgram::load(path, key) == nullptr);
+    };
+
+    // x <- f(2, -3) assigns to a literal.
+    retype(AST::AssignKind, 1, AST::LiteralKind);
+
+    // The function list holds a return.
+    retype(AST::FunctionListKind, 1, AST::ReturnKind);
+
+    // The body of the if is a return, rather than a list holding one.
+    retype(AST::IfKind, 4, AST::ReturnKind);
+  }
+
+  SECTION("missing images are ignored") {
+    std::remove(path.c_str());
+    REQUIRE(AST::CachedProgram::load(path, key) == nullptr);
+  }
+
+  std::remove(path.c_str());
+}
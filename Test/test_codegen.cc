@@ -0,0 +1,77 @@
+#include <string>
+
+#include "llvm/IR/Instructions.h"
+
+#include "compiler.hh"
+#include "catch.hh"
+#include "fixtures.hh"
+
+static llvm::BasicBlock *block(llvm::Function *f, llvm::StringRef name) {
+  for(auto &b : *f) {
+    if(b.getName() == name) {
+      return &b;
+    }
+  }
+  return nullptr;
+}
+
+TEST_CASE("loops are emitted in rotated form", "[codegen]") {
+  Compiler::State s;
+  compile(s, "function f(a)\n  while [a] < 3\n    [a] <- [a] + 1\n  end\n  return [a]\nend\n");
+  auto f = s.Mod->getFunction("f");
+
+  auto preheader = block(f, "while.preheader");
+  auto body = block(f, "while.body");
+  auto latch = block(f, "while.latch");
+  auto exit = block(f, "while.exit");
+  REQUIRE(preheader != nullptr);
+  REQUIRE(body != nullptr);
+  REQUIRE(latch != nullptr);
+  REQUIRE(exit != nullptr);
+
+  SECTION("the entry guards the loop and the latch branches back") {
+    REQUIRE(llvm::cast<llvm::BranchInst>(f->getEntryBlock().getTerminator())->isConditional());
+    REQUIRE(preheader->getSingleSuccessor() == body);
+
+    auto back = llvm::cast<llvm::BranchInst>(latch->getTerminator());
+    REQUIRE(back->isConditional());
+    REQUIRE(back->getSuccessor(0) == body);
+    REQUIRE(back->getSuccessor(1) == exit);
+  }
+
+  SECTION("the latch carries a loop ID") {
+    auto id = latch->getTerminator()->getMetadata(llvm::LLVMContext::MD_loop);
+    REQUIRE(id != nullptr);
+    REQUIRE(id->getOperand(0) == id);
+  }
+}
+
+TEST_CASE("ifs branch to a merge block", "[codegen]") {
+  Compiler::State s;
+
+  SECTION("both branches rejoin") {
+    compile(s, "function f(a)\n  if a > 0\n    b <- 1\n  else\n    b <- 2\n  end\n  return b\nend\n");
+    auto f = s.Mod->getFunction("f");
+    auto end = block(f, "if.end");
+    REQUIRE(end != nullptr);
+    REQUIRE(end->hasNPredecessors(2));
+  }
+
+  SECTION("a branch that returns doesn't fall through") {
+    compile(s, "function f(a)\n  if a > 0\n    return 1\n    a <- 2\n  end\n  return 3\nend\n");
+    auto end = block(s.Mod->getFunction("f"), "if.end");
+    REQUIRE(end->hasNPredecessors(1));
+  }
+
+  SECTION("falling off the end of a function returns 0") {
+    compile(s, "function f(a)\n  if a > 0\n    a <- 1\n  end\nend\n");
+    auto ret = llvm::cast<llvm::ReturnInst>(block(s.Mod->getFunction("f"), "if.end")->getTerminator());
+    REQUIRE(llvm::cast<llvm::ConstantInt>(ret->getReturnValue())->isZero());
+  }
+}
+
+TEST_CASE("calls can come before the function they call", "[codegen]") {
+  Compiler::State s;
+  compile(s, "function f(a)\n  return g(a, 1)\nend\nfunction g(a, b)\n  return a + b\nend\n");
+  REQUIRE_FALSE(s.Mod->getFunction("g")->isDeclaration());
+}
@@ -0,0 +1,128 @@
+#include <cstring>
+#include <string>
+
+#include "llvm/ExecutionEngine/Orc/LLJIT.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "compiler.hh"
+#include "emit.hh"
+#include "optimize.hh"
+#include "catch.hh"
+#include "fixtures.hh"
+
+static std::string emit(Compiler::Output kind) {
+  std::string error;
+  auto machine = Compiler::hostMachine(error);
+  REQUIRE(machine != nullptr);
+
+  Compiler::State s;
+  compile(s, "function f(a)\n  return a + 1\nend\n[0] <- f(41)\n");
+
+  std::string out;
+  llvm::raw_string_ostream os(out);
+  llvm::buffer_ostream buffer(os);
+  REQUIRE(Compiler::emit(*s.Mod, *machine, kind, buffer, error));
+  return std::string(buffer.str());
+}
+
+TEST_CASE("the arguments of --emit are read", "[emit]") {
+  Compiler::Output kind;
+  REQUIRE(Compiler::parseOutput("obj", kind));
+  REQUIRE(kind == Compiler::Output::Object);
+  REQUIRE(Compiler::parseOutput("exe", kind));
+  REQUIRE(kind == Compiler::Output::Executable);
+  REQUIRE_FALSE(Compiler::parseOutput("elf", kind));
+  REQUIRE(Compiler::extension(Compiler::Output::Assembly) == "s");
+}
+
+TEST_CASE("modules are written in each format", "[emit]") {
+  SECTION("object files") {
+    REQUIRE(emit(Compiler::Output::Object).substr(0, 4) == "\x7f" "ELF");
+  }
+
+  SECTION("assembly") {
+    REQUIRE(emit(Compiler::Output::Assembly).find("main:") != std::string::npos);
+  }
+
+  SECTION("bitcode") {
+    REQUIRE(emit(Compiler::Output::Bitcode).substr(0, 2) == "BC");
+  }
+
+  SECTION("textual IR") {
+    REQUIRE(emit(Compiler::Output::IR).find("define i32 @main") != std::string::npos);
+  }
+}
+
+TEST_CASE("the runtime adds an entry point", "[emit]") {
+  std::string error;
+  auto machine = Compiler::hostMachine(error);
+  REQUIRE(machine != nullptr);
+
+  Compiler::State s;
+  compile(s, "[0] <- 1\n");
+  s.Mod->setTargetTriple(machine->getTargetTriple().str());
+  REQUIRE(Compiler::addRuntime(*s.Mod, error));
+
+  auto start = s.Mod->getFunction("_start");
+  REQUIRE(start != nullptr);
+  REQUIRE(start->doesNotReturn());
+  REQUIRE_FALSE(llvm::verifyModule(*s.Mod, &llvm::errs()));
+}
+
+TEST_CASE("the runtime's names are reserved", "[emit]") {
+  std::string error;
+  auto machine = Compiler::hostMachine(error);
+  REQUIRE(machine != nullptr);
+
+  Compiler::State s;
+  compile(s, "function memset(a)\n  return a\nend\n[0] <- memset(1)\n");
+  s.Mod->setTargetTriple(machine->getTargetTriple().str());
+  REQUIRE_FALSE(Compiler::addRuntime(*s.Mod, error));
+  REQUIRE(error == "The program defines memset, which executables need for the runtime");
+}
+
+TEST_CASE("the runtime's memory functions work", "[emit]") {
+  std::string error;
+  auto machine = Compiler::hostMachine(error);
+  REQUIRE(machine != nullptr);
+
+  Compiler::State s;
+  compile(s, "[0] <- 1\n");
+  s.Mod->setTargetTriple(machine->getTargetTriple().str());
+  REQUIRE(Compiler::addRuntime(*s.Mod, error));
+
+  auto jit = llvm::cantFail(llvm::orc::LLJITBuilder().create());
+  s.Mod->setDataLayout(jit->getDataLayout());
+  llvm::orc::ThreadSafeModule module(std::move(s.Mod), llvm::orc::ThreadSafeContext(std::move(s.context)));
+  llvm::cantFail(jit->addIRModule(std::move(module)));
+
+  using Copy = void *(*)(void *, const void *, size_t);
+  auto memset = reinterpret_cast<void *(*)(void *, int, size_t)>(llvm::cantFail(jit->lookup("memset")).getAddress());
+  auto memcpy = reinterpret_cast<Copy>(llvm::cantFail(jit->lookup("memcpy")).getAddress());
+  auto memmove = reinterpret_cast<Copy>(llvm::cantFail(jit->lookup("memmove")).getAddress());
+
+  char buffer[] = "abcdefgh";
+
+  SECTION("memset") {
+    REQUIRE(memset(buffer + 1, 'x', 3) == buffer + 1);
+    REQUIRE(std::strcmp(buffer, "axxxefgh") == 0);
+    memset(buffer, 'y', 0);
+    REQUIRE(buffer[0] == 'a');
+  }
+
+  SECTION("memcpy") {
+    REQUIRE(memcpy(buffer, buffer + 4, 4) == buffer);
+    REQUIRE(std::strcmp(buffer, "efghefgh") == 0);
+  }
+
+  SECTION("memmove onto the end of the source") {
+    memmove(buffer + 2, buffer, 5);
+    REQUIRE(std::strcmp(buffer, "ababcdeh") == 0);
+  }
+
+  SECTION("memmove onto the start of the source") {
+    memmove(buffer, buffer + 2, 5);
+    REQUIRE(std::strcmp(buffer, "cdefgfgh") == 0);
+  }
+}
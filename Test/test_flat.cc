@@ -0,0 +1,57 @@
+#include <string>
+
+#include "flat.hh"
+#include "parser.hh"
+#include "catch.hh"
+
+TEST_CASE("flat tree mirrors the AST", "[flat]") {
+  std::string source = R"(
+    function f(a, b)
+      if a > 1
+        return a
+      end
+      return f(a - 1, [b])
+    end
+
+    x <- f(2, 3)
+  )";
+  Parser p(source);
+  auto prog = p.parseProgram();
+  REQUIRE(prog != nullptr);
+
+  AST::FlatTree tree(prog);
+
+  SECTION("flat tree numbers nodes in preorder") {
+    REQUIRE(tree.kinds[0] == AST::ProgramKind);
+    REQUIRE(tree.kinds[1] == AST::FunctionListKind);
+    REQUIRE(tree.kinds[2] == AST::FunctionDeclKind);
+    REQUIRE(tree.children(0).size() == 2);
+    REQUIRE(tree.children(0)[0] == 1);
+    REQUIRE(tree.children(1).size() == 1);
+  }
+
+  SECTION("flat tree keeps names and parameters") {
+    REQUIRE(tree.name(2) == "f");
+    auto &decl = tree.decls[tree.payloads[2]];
+    REQUIRE(decl.paramCount == 2);
+    REQUIRE(tree.names[tree.params[decl.firstParam + 1]].str() == "b");
+  }
+
+  SECTION("flat tree marks absent children") {
+    auto body = tree.children(2)[0];
+    auto branch = tree.children(body)[0];
+
+    REQUIRE(tree.kinds[branch] == AST::IfKind);
+    REQUIRE(tree.children(branch)[2] == AST::FlatTree::none);
+  }
+
+  SECTION("flat tree keeps payloads") {
+    auto statements = tree.children(0)[1];
+    auto assign = tree.children(statements)[0];
+    auto call = tree.children(assign)[1];
+
+    REQUIRE(tree.kinds[call] == AST::CallKind);
+    REQUIRE(tree.name(call) == "f");
+    REQUIRE(tree.value(tree.children(call)[1]) == 3);
+  }
+}
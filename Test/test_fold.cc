@@ -0,0 +1,122 @@
+#include <string>
+
+#include "fold.hh"
+#include "parser.hh"
+#include "resolve.hh"
+#include "catch.hh"
+#include "fixtures.hh"
+
+static size_t count(AST::Node *list) {
+  return llvm::cast<AST::StatementList>(list)->statements.size();
+}
+
+// The value assigned by the last top level statement.
+static AST::Node *value(AST::Program *prog) {
+  auto body = prog->body;
+  return llvm::cast<AST::Assign>(statement(body, count(body) - 1))->value;
+}
+
+static AST::Program *folded(Parser &p, AST::Folder &f) {
+  auto prog = p.parseProgram();
+  REQUIRE(prog != nullptr);
+  REQUIRE(AST::Resolver().resolve(prog));
+  f.fold(prog);
+  return prog;
+}
+
+TEST_CASE("folder evaluates constant expressions", "[fold]") {
+  AST::Folder f;
+
+  SECTION("arithmetic over literals becomes a literal") {
+    Parser p("x <- 2 * 3 + (10 - 4) / 2\n");
+    auto lit = llvm::dyn_cast<AST::Literal>(value(folded(p, f)));
+    REQUIRE(lit != nullptr);
+    REQUIRE(lit->value == 9);
+  }
+
+  SECTION("arithmetic wraps") {
+    Parser p("x <- 2147483647 + 1\n");
+    auto lit = llvm::dyn_cast<AST::Literal>(value(folded(p, f)));
+    REQUIRE(lit != nullptr);
+    REQUIRE(lit->value == INT32_MIN);
+  }
+
+  SECTION("division by zero is left alone") {
+    Parser p("x <- 1 / 0\ny <- 7 % (2 - 2)\n");
+    auto prog = folded(p, f);
+    REQUIRE(llvm::isa<AST::BinaryOp>(llvm::cast<AST::Assign>(statement(prog->body, 0))->value));
+    REQUIRE(llvm::isa<AST::BinaryOp>(value(prog)));
+  }
+
+  SECTION("constant operands are folded inside other expressions") {
+    Parser p("a <- 1\nx <- [a + (2 * 2)]\n");
+    auto deref = llvm::dyn_cast<AST::Deref>(value(folded(p, f)));
+    REQUIRE(deref != nullptr);
+    auto sum = llvm::cast<AST::BinaryOp>(deref->address);
+    REQUIRE(llvm::cast<AST::Literal>(sum->right)->value == 4);
+  }
+}
+
+TEST_CASE("folder applies algebraic identities", "[fold]") {
+  AST::Folder f;
+
+  SECTION("adding zero and multiplying by one disappear") {
+    Parser p("a <- 5\nx <- (0 + a * 1) - 0\n");
+    auto var = llvm::dyn_cast<AST::Variable>(value(folded(p, f)));
+    REQUIRE(var != nullptr);
+    REQUIRE(var->name == Symbol::intern("a"));
+  }
+
+  SECTION("multiplying by zero keeps calls") {
+    Parser p("function g()\n  return 1\nend\na <- 5\nx <- a * 0\ny <- g() * 0\n");
+    auto prog = folded(p, f);
+    REQUIRE(llvm::isa<AST::Literal>(llvm::cast<AST::Assign>(statement(prog->body, 1))->value));
+    REQUIRE(llvm::isa<AST::BinaryOp>(value(prog)));
+  }
+
+  SECTION("double negation cancels") {
+    Parser p("a <- 5\nif not not a > 1\n  x <- 1\nend\n");
+    auto prog = folded(p, f);
+    auto cond = llvm::cast<AST::If>(statement(prog->body, 1))->condition;
+    auto cmp = llvm::dyn_cast<AST::BinaryOp>(cond);
+    REQUIRE(cmp != nullptr);
+    REQUIRE(cmp->type == AST::Gt);
+  }
+}
+
+TEST_CASE("folder prunes constant control flow", "[fold]") {
+  AST::Folder f;
+
+  SECTION("a true if is replaced by its body") {
+    Parser p("x <- 0\nif 1 < 2\n  x <- 1\n  y <- 2\nelse\n  x <- 3\nend\nz <- x\n");
+    auto prog = folded(p, f);
+    REQUIRE(count(prog->body) == 4);
+    auto first = llvm::cast<AST::Assign>(statement(prog->body, 1));
+    REQUIRE(llvm::cast<AST::Literal>(first->value)->value == 1);
+  }
+
+  SECTION("a false if is replaced by its else branch, or nothing") {
+    Parser p("x <- 0\nif 2 < 1\n  x <- 1\nelse\n  x <- 3\nend\nif 1 = 2\n  x <- 4\nend\n");
+    auto prog = folded(p, f);
+    REQUIRE(count(prog->body) == 2);
+    auto kept = llvm::cast<AST::Assign>(statement(prog->body, 1));
+    REQUIRE(llvm::cast<AST::Literal>(kept->value)->value == 3);
+  }
+
+  SECTION("loops that never run are removed") {
+    Parser p("function g(a)\n  while 3 < 2\n    a <- a + 1\n  end\n  return a\nend\n");
+    auto prog = folded(p, f);
+    auto g = llvm::cast<AST::FunctionDecl>(llvm::cast<AST::FunctionList>(prog->functions)->functions[0]);
+    REQUIRE(count(g->body) == 1);
+    REQUIRE(llvm::isa<AST::Return>(statement(g->body, 0)));
+  }
+
+  SECTION("loops with unknown conditions are kept") {
+    Parser p("x <- 0\nwhile x < 3 and 1 = 1\n  x <- x + 1\nend\n");
+    auto prog = folded(p, f);
+    auto loop = llvm::dyn_cast<AST::WhileLoop>(statement(prog->body, 1));
+    REQUIRE(loop != nullptr);
+    REQUIRE(llvm::isa<AST::BinaryOp>(loop->condition));
+    REQUIRE(llvm::cast<AST::BinaryOp>(loop->condition)->type == AST::Lt);
+  }
+}
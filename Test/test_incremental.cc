@@ -0,0 +1,126 @@
+#include <string>
+
+#include "incremental.hh"
+#include "catch.hh"
+
+static std::string program() {
+  std::string source;
+  for(int i = 0; i < 20; ++i) {
+    auto n = std::to_string(i);
+    source += "function f" + n + "(a)\n  x <- a + " + n + "\n";
+    source += "  if x > 3\n    return x\n  end\n  return 0\nend\n\n";
+  }
+  source += "y <- f1(2)\n\nwhile y < 10\n  y <- y + 1\nend\nz <- y\n";
+  return source;
+}
+
+static AST::FunctionList *functions(AST::Program *prog) {
+  return llvm::dyn_cast_or_null<AST::FunctionList>(prog->functions);
+}
+
+static AST::StatementList *statements(AST::Program *prog) {
+  return llvm::dyn_cast_or_null<AST::StatementList>(prog->body);
+}
+
+TEST_CASE("incremental parser reuses unchanged units", "[incremental]") {
+  auto source = program();
+  IncrementalParser ip(source);
+  REQUIRE(ip.program() != nullptr);
+
+  std::vector<AST::Node *> before = functions(ip.program())->functions;
+  std::vector<AST::Node *> body = statements(ip.program())->statements;
+  REQUIRE(before.size() == 20);
+  REQUIRE(body.size() == 3);
+
+  SECTION("incremental parser reparses only the edited function") {
+    auto at = source.find("a + 7");
+    auto prog = ip.apply({ at + 4, 1, "1234" });
+
+    REQUIRE(prog != nullptr);
+    auto after = functions(prog)->functions;
+    REQUIRE(after.size() == 20);
+    for(size_t i = 0; i < 20; ++i) {
+      if(i == 7) {
+        REQUIRE(after[i] != before[i]);
+      } else {
+        REQUIRE(after[i] == before[i]);
+      }
+    }
+    REQUIRE(statements(prog)->statements.vec() == body);
+
+    auto decl = llvm::dyn_cast_or_null<AST::FunctionDecl>(after[7]);
+    auto assign = llvm::dyn_cast_or_null<AST::Assign>(llvm::dyn_cast_or_null<AST::StatementList>(decl->body)->statements[0]);
+    auto sum = llvm::dyn_cast_or_null<AST::BinaryOp>(assign->value);
+    REQUIRE(llvm::dyn_cast_or_null<AST::Literal>(sum->right)->value == 1234);
+  }
+
+  SECTION("incremental parser shifts the units after an edit") {
+    ip.apply({ 0, 0, "function g()\nend\n" });
+    auto at = ip.source().find("a + 19");
+    auto prog = ip.apply({ at + 4, 2, "5" });
+
+    REQUIRE(prog != nullptr);
+    auto after = functions(prog)->functions;
+    REQUIRE(after.size() == 21);
+    REQUIRE(llvm::dyn_cast_or_null<AST::FunctionDecl>(after[0])->name.str() == "g");
+    REQUIRE(after[19] == before[18]);
+    REQUIRE(after[20] != before[19]);
+  }
+
+  SECTION("incremental parser can add and remove units") {
+    auto at = ip.source().find("y <- f1(2)");
+    ip.apply({ at, 0, "function h()\nend\n" });
+
+    REQUIRE(functions(ip.program())->functions.size() == 21);
+
+    at = ip.source().find("z <- y");
+    ip.apply({ at, 6, "" });
+    auto prog = ip.apply({ at, 0, "\n\nw <- 1\nv <- w" });
+
+    REQUIRE(prog != nullptr);
+    REQUIRE(statements(prog)->statements.size() == 4);
+    REQUIRE(ip.source().substr(ip.source().size() - 14) == "w <- 1\nv <- w\n");
+  }
+
+  SECTION("incremental parser falls back to a whole parse") {
+    auto at = source.find("end\n\nfunction f3");
+    auto prog = ip.apply({ at, 3, "" });
+
+    REQUIRE(prog == nullptr);
+    REQUIRE_FALSE(ip.errors.empty());
+
+    prog = ip.apply({ at, 0, "end" });
+    REQUIRE(prog != nullptr);
+    REQUIRE(ip.source() == source);
+    REQUIRE(functions(prog)->functions.size() == 20);
+  }
+
+  SECTION("incremental parser keeps functions before statements") {
+    auto at = ip.source().find("z <- y");
+    auto prog = ip.apply({ at, 6, "function late()\nend" });
+
+    REQUIRE(prog == nullptr);
+  }
+
+  SECTION("incremental parser agrees with a whole parse") {
+    std::vector<Edit> edits = {
+      { source.find("return 0"), 8, "return 1 + 2" },
+      { source.find("if x > 3"), 0, "x <- x * 2\n  " },
+      { source.find("while"), 0, "\n" },
+      { 5, 3, "" },
+      { source.find("y <- f1(2)") - 1, 1, "\n\n\n" },
+    };
+
+    for(auto &edit : edits) {
+      ip.apply(edit);
+      Parser whole(ip.source());
+      auto prog = whole.parseProgram();
+
+      REQUIRE((ip.program() == nullptr) == (prog == nullptr));
+      if(prog) {
+        REQUIRE(functions(ip.program())->functions.size() == functions(prog)->functions.size());
+        REQUIRE(statements(ip.program())->statements.size() == statements(prog)->statements.size());
+      }
+    }
+  }
+}
@@ -0,0 +1,50 @@
+#include <string>
+
+#include "compiler.hh"
+#include "jit.hh"
+#include "catch.hh"
+#include "fixtures.hh"
+
+// Compiles source, which must resolve, and runs it in the JIT.
+static int run(const std::string &source, bool lazy = false) {
+  Compiler::State s;
+  compile(s, source);
+
+  int result = -1;
+  std::string error;
+  REQUIRE(Compiler::run(s, result, error, lazy));
+  return result;
+}
+
+TEST_CASE("programs run in the JIT", "[jit]") {
+  SECTION("the result is memory[0]") {
+    REQUIRE(run("[0] <- 6 * 7\n") == 42);
+  }
+
+  SECTION("functions are called") {
+    REQUIRE(run("function f(a)\n  return a + 1\nend\n[0] <- f(f(1))\n") == 3);
+  }
+
+  SECTION("memory starts out zeroed") {
+    REQUIRE(run("[1] <- 5\n") == 0);
+  }
+}
+
+TEST_CASE("functions are compiled lazily", "[jit]") {
+  SECTION("calls go through the stubs") {
+    REQUIRE(run("function f(a)\n  return g(a) * 2\nend\n"
+                "function g(a)\n  return a + 1\nend\n"
+                "[0] <- f(4)\n", true) == 10);
+  }
+
+  SECTION("functions that are never called don't get in the way") {
+    REQUIRE(run("function f(a)\n  return a\nend\n"
+                "function g(a)\n  return f(a) + 1\nend\n"
+                "[0] <- 7\n", true) == 7);
+  }
+
+  SECTION("memory is shared between the functions") {
+    REQUIRE(run("function f(a)\n  [0] <- a\n  return 0\nend\n"
+                "x <- f(9)\n", true) == 9);
+  }
+}
@@ -0,0 +1,180 @@
+#include <string>
+
+#include "lexer.hh"
+#include "structure.hh"
+#include "symbol.hh"
+#include "catch.hh"
+
+TEST_CASE("lexer can tokenise operators", "[lexer]") {
+  SECTION("lexer prefers the longest operator") {
+    Lex::Lexer l("<- <= < >= > != =");
+
+    REQUIRE(l.tokens.size() == 9);
+    REQUIRE(l.tokens[0].type == Lex::Arrow);
+    REQUIRE(l.tokens[1].type == Lex::LtEq);
+    REQUIRE(l.tokens[2].type == Lex::Lt);
+    REQUIRE(l.tokens[3].type == Lex::GtEq);
+    REQUIRE(l.tokens[4].type == Lex::Gt);
+    REQUIRE(l.tokens[5].type == Lex::Neq);
+    REQUIRE(l.tokens[6].type == Lex::Eq);
+  }
+
+  SECTION("lexer does not need whitespace between tokens") {
+    Lex::Lexer l("[x]<-f(1,y)");
+
+    REQUIRE(l.tokens.size() == 12);
+    REQUIRE(l.tokens[0].type == Lex::LeftBracket);
+    REQUIRE(l.tokens[3].type == Lex::Arrow);
+    REQUIRE(l.tokens[5].type == Lex::LeftParen);
+    REQUIRE(l.tokens[7].type == Lex::Comma);
+    REQUIRE(l.tokens[9].type == Lex::RightParen);
+  }
+
+  SECTION("lexer marks unknown characters") {
+    Lex::Lexer l("a ? b");
+
+    REQUIRE(l.tokens[1].type == Lex::Unknown);
+    REQUIRE(l.tokens[1].offset == 2);
+  }
+}
+
+TEST_CASE("lexer can tokenise words and numbers", "[lexer]") {
+  SECTION("lexer decodes numbers") {
+    Lex::Lexer l("0 42 1234567");
+
+    REQUIRE(l.tokens[0].value == 0);
+    REQUIRE(l.tokens[1].value == 42);
+    REQUIRE(l.tokens[2].value == 1234567);
+  }
+
+  SECTION("lexer recognises keywords") {
+    Lex::Lexer l("if else while function return end true false not and or");
+
+    REQUIRE(l.tokens[0].type == Lex::If);
+    REQUIRE(l.tokens[5].type == Lex::End);
+    REQUIRE(l.tokens[10].type == Lex::Or);
+  }
+
+  SECTION("lexer interns repeated identifiers once") {
+    Lex::Lexer l("abc x abc _y1");
+
+    REQUIRE(l.tokens[0].value == l.tokens[2].value);
+    REQUIRE(l.tokens[0].value != l.tokens[1].value);
+    REQUIRE(Symbol(l.tokens[3].value).str() == "_y1");
+  }
+}
+
+TEST_CASE("lexer tracks lines", "[lexer]") {
+  SECTION("lexer collapses blank lines") {
+    Lex::Lexer l("\n\n  a\n\n\n  b  \n");
+
+    REQUIRE(l.tokens.size() == 5);
+    REQUIRE(l.lines.lineOf(l.tokens[0].offset) == 3);
+    REQUIRE(l.tokens[1].type == Lex::Newline);
+    REQUIRE(l.lines.lineOf(l.tokens[2].offset) == 6);
+    REQUIRE(l.tokens[3].type == Lex::Newline);
+    REQUIRE(l.tokens[4].type == Lex::EndOfFile);
+  }
+
+  SECTION("lexer terminates the last line") {
+    Lex::Lexer l("a");
+
+    REQUIRE(l.tokens.size() == 3);
+    REQUIRE(l.tokens[1].type == Lex::Newline);
+  }
+
+  SECTION("lexer handles empty input") {
+    Lex::Lexer l("   \n ");
+
+    REQUIRE(l.tokens.size() == 1);
+    REQUIRE(l.tokens[0].type == Lex::EndOfFile);
+  }
+}
+
+TEST_CASE("lexer only recognises whole keywords", "[lexer]") {
+  SECTION("lexer does not match keyword prefixes or extensions") {
+    Lex::Lexer l("iff en functions function_ ends _if Or");
+
+    for(size_t i = 0; i < 7; ++i) {
+      REQUIRE(l.tokens[i].type == Lex::Identifier);
+    }
+  }
+
+  SECTION("lexer handles words longer than any keyword") {
+    Lex::Lexer l("functionfunction returned_value");
+
+    REQUIRE(l.tokens[0].type == Lex::Identifier);
+    REQUIRE(l.tokens[1].type == Lex::Identifier);
+    REQUIRE(Symbol(l.tokens[0].value).str() == "functionfunction");
+  }
+
+  SECTION("lexer does not extend a lone bang") {
+    Lex::Lexer l("! =");
+
+    REQUIRE(l.tokens[0].type == Lex::Unknown);
+    REQUIRE(l.tokens[1].type == Lex::Eq);
+  }
+}
+
+TEST_CASE("lexer builds a line index", "[lexer]") {
+  SECTION("line index maps offsets to lines") {
+    Lex::Lexer l("a\nbb\n\nccc");
+
+    REQUIRE(l.lines.starts.size() == 4);
+    REQUIRE(l.lines.lineOf(0) == 1);
+    REQUIRE(l.lines.lineOf(1) == 1);
+    REQUIRE(l.lines.lineOf(2) == 2);
+    REQUIRE(l.lines.lineOf(5) == 3);
+    REQUIRE(l.lines.lineOf(6) == 4);
+    REQUIRE(l.lines.lineOf(8) == 4);
+  }
+
+  SECTION("lexer only sees the given view") {
+    std::string source = "x <- 1\ny <- 2";
+    Lex::Lexer l(std::string_view(source).substr(0, 6));
+
+    REQUIRE(l.tokens.size() == 5);
+    REQUIRE(l.tokens[3].type == Lex::Newline);
+  }
+}
+
+TEST_CASE("structural index finds token starts", "[lexer]") {
+  std::string source;
+  for(int i = 0; i < 300; ++i) {
+    source += "x" + std::to_string(i) + " <- [abc_" + std::to_string(i % 7) + "]*-12 \t\n";
+    source += static_cast<char>(i % 256);
+  }
+
+  auto build = [&](Lex::StructuralIndexer::Kernel k) {
+    Lex::StructuralIndexer indexer(k);
+    std::vector<uint32_t> starts(source.size());
+    auto count = indexer.index(source, 0, 640, starts.data());
+    count += indexer.index(source, 640, source.size(), starts.data() + count);
+    starts.resize(count);
+    return starts;
+  };
+
+  SECTION("scalar kernel marks words, operators and newlines") {
+    Lex::StructuralIndexer indexer(Lex::StructuralIndexer::Scalar);
+    std::vector<uint32_t> starts(14);
+    starts.resize(indexer.index("ab1 <-  [c]\n_d", 0, 14, starts.data()));
+
+    REQUIRE(starts == std::vector<uint32_t>({ 0, 4, 5, 8, 9, 10, 11, 12 }));
+  }
+
+  SECTION("words continue across block boundaries") {
+    std::string word(130, 'a');
+    Lex::StructuralIndexer indexer;
+    std::vector<uint32_t> starts(word.size());
+    starts.resize(indexer.index(word, 0, word.size(), starts.data()));
+
+    REQUIRE(starts == std::vector<uint32_t>({ 0 }));
+  }
+
+  SECTION("vector kernels agree with the scalar kernel") {
+    auto scalar = build(Lex::StructuralIndexer::Scalar);
+
+    REQUIRE(build(Lex::StructuralIndexer::SSE2) == scalar);
+    REQUIRE(build(Lex::StructuralIndexer::AVX2) == scalar);
+  }
+}
@@ -14,15 +14,22 @@ TEST_CASE("parser can be initialised properly", "[parser]") {
   Parser p(source); 
 
   SECTION("parser splits by lines correctly") {
-    REQUIRE(p.lines.size() == 3);
-    REQUIRE(p.lines[0] == "this is a");
-    REQUIRE(p.lines[1] == "multi line");
-    REQUIRE(p.lines[2] == "string");
+    REQUIRE(p.tokens.size() == 10);
+    REQUIRE(p.tokens[3].type == Lex::Newline);
+    REQUIRE(p.tokens[6].type == Lex::Newline);
+    REQUIRE(p.tokens[8].type == Lex::Newline);
+    REQUIRE(p.tokens[9].type == Lex::EndOfFile);
+  }
+
+  SECTION("parser interns identifiers") {
+    REQUIRE(p.tokens[0].type == Lex::Identifier);
+    REQUIRE(Symbol(p.tokens[0].value).str() == "this");
+    REQUIRE(p.lines.lineOf(p.tokens[7].offset) == 4);
+    REQUIRE(Symbol(p.tokens[7].value).str() == "string");
   }
 
   SECTION("parser initialises position correctly") {
-    REQUIRE(p.line == p.lines.begin());
-    REQUIRE(p.column == p.lines[0].begin());
+    REQUIRE(p.pos == 0);
   }
 }
 
@@ -48,22 +55,44 @@ TEST_CASE("parser can parse numeric literals", "[parser]") {
   SECTION("parser does not parse non-numerics") {
     std::string source = "-abcdef";
     Parser p(source);
-    auto it = p.column;
+    auto it = p.pos;
     auto lit = p.parseLiteral();
 
     REQUIRE(lit == nullptr);
-    REQUIRE(p.column == it);
+    REQUIRE(p.pos == it);
   }
 
   SECTION("parser parses until it can't") {
     std::string source = "   534abc";
     Parser p(source);
-    auto it = p.column;
     auto lit = p.parseLiteral();
 
     REQUIRE(lit != nullptr);
     REQUIRE(lit->value == 534);
-    REQUIRE(*(p.column) == 'a');
+    REQUIRE(p.tokens[p.pos].type == Lex::Identifier);
+    REQUIRE(Symbol(p.tokens[p.pos].value).str() == "abc");
+  }
+
+  SECTION("parser parses the extremes of int32") {
+    Parser p("2147483647 -2147483648");
+    auto max = p.parseLiteral();
+    auto min = p.parseLiteral();
+
+    REQUIRE(max != nullptr);
+    REQUIRE(max->value == INT32_MAX);
+    REQUIRE(min != nullptr);
+    REQUIRE(min->value == INT32_MIN);
+    REQUIRE(p.errors.empty());
+  }
+
+  SECTION("parser reports literals that don't fit in int32") {
+    Parser big("x <- 1\n[0] <- 99999999999\n");
+    REQUIRE(big.parseProgram() == nullptr);
+    REQUIRE(big.errors[0] == "Integer literal out of range at line 2");
+
+    Parser min("x <- 2147483648\n");
+    REQUIRE(min.parseProgram() == nullptr);
+    REQUIRE(min.errors[0] == "Integer literal out of range at line 1");
   }
 }
 
@@ -95,13 +124,23 @@ TEST_CASE("parser can parse boolean literals", "[parser]") {
   }
 
   SECTION("parser parses until it can't") {
-    std::string source = "   true1234";
+    std::string source = "   true 1234";
     Parser p(source);
     auto lit = p.parseBooleanLiteral();
 
     REQUIRE(lit != nullptr);
     REQUIRE(lit->value == true);
-    REQUIRE(*(p.column) == '1');
+    REQUIRE(p.tokens[p.pos].type == Lex::Number);
+    REQUIRE(p.tokens[p.pos].value == 1234);
+  }
+
+  SECTION("parser does not split identifiers at keywords") {
+    std::string source = "true1234";
+    Parser p(source);
+    auto lit = p.parseBooleanLiteral();
+
+    REQUIRE(lit == nullptr);
+    REQUIRE(p.pos == 0);
   }
 }
 
@@ -112,7 +151,7 @@ TEST_CASE("parser can parse variable names", "[parser]") {
     auto var = p.parseVariable();
     
     REQUIRE(var != nullptr);
-    REQUIRE(var->name == "variable");
+    REQUIRE(var->name.str() == "variable");
   }
 
   SECTION("parser parses name with underscores") {
@@ -121,7 +160,7 @@ TEST_CASE("parser can parse variable names", "[parser]") {
     auto var = p.parseVariable();
     
     REQUIRE(var != nullptr);
-    REQUIRE(var->name == "_some_variable_name");
+    REQUIRE(var->name.str() == "_some_variable_name");
   }
 
   SECTION("parser stops at invalid characters") {
@@ -130,8 +169,8 @@ TEST_CASE("parser can parse variable names", "[parser]") {
     auto var = p.parseVariable();
     
     REQUIRE(var != nullptr);
-    REQUIRE(var->name == "variable");
-    REQUIRE(*(p.column) == '-');
+    REQUIRE(var->name.str() == "variable");
+    REQUIRE(p.tokens[p.pos].type == Lex::Minus);
   }
 
   SECTION("parser fails if starting with invalid character", "[parser]") {
@@ -140,7 +179,8 @@ TEST_CASE("parser can parse variable names", "[parser]") {
     auto var = p.parseVariable();
 
     REQUIRE(var == nullptr);
-    REQUIRE(*(p.column) == '?');
+    REQUIRE(p.tokens[p.pos].type == Lex::Unknown);
+    REQUIRE(p.tokens[p.pos].offset == 0);
   }
 }
 
@@ -251,7 +291,7 @@ TEST_CASE("parser can parse factors", "[parser]") {
   SECTION("parser can parse a literal factor") {
     std::string source = "6781";
     Parser p(source);
-    auto fa = dynamic_cast<AST::Literal *>(p.parseFactor());
+    auto fa = llvm::dyn_cast_or_null<AST::Literal>(p.parseFactor());
 
     REQUIRE(fa != nullptr);
     REQUIRE(fa->value == 6781);
@@ -260,16 +300,16 @@ TEST_CASE("parser can parse factors", "[parser]") {
   SECTION("parser can parse a variable factor") {
     std::string source = "xyz";
     Parser p(source);
-    auto fa = dynamic_cast<AST::Variable *>(p.parseFactor());
+    auto fa = llvm::dyn_cast_or_null<AST::Variable>(p.parseFactor());
 
     REQUIRE(fa != nullptr);
-    REQUIRE(fa->name == "xyz");
+    REQUIRE(fa->name.str() == "xyz");
   }
 
   SECTION("parser can parse a parens factor") {
     std::string source = "( 1 )";
     Parser p(source);
-    auto fa = dynamic_cast<AST::Literal *>(p.parseFactor());
+    auto fa = llvm::dyn_cast_or_null<AST::Literal>(p.parseFactor());
 
     REQUIRE(fa != nullptr);
     REQUIRE(fa->value == 1);
@@ -278,10 +318,10 @@ TEST_CASE("parser can parse factors", "[parser]") {
   SECTION("parser can parse a deref factor") {
     std::string source = "[ 123 ]";
     Parser p(source);
-    auto fa = dynamic_cast<AST::Deref *>(p.parseFactor());
+    auto fa = llvm::dyn_cast_or_null<AST::Deref>(p.parseFactor());
 
     REQUIRE(fa != nullptr);
-    auto address = dynamic_cast<AST::Literal *>(fa->address);
+    auto address = llvm::dyn_cast_or_null<AST::Literal>(fa->address);
     REQUIRE(address != nullptr);
     REQUIRE(address->value == 123);
   }
@@ -289,10 +329,10 @@ TEST_CASE("parser can parse factors", "[parser]") {
   SECTION("parser can parse a call factor") {
     std::string source = "f(123, b)";
     Parser p(source);
-    auto fa = dynamic_cast<AST::Call *>(p.parseFactor());
+    auto fa = llvm::dyn_cast_or_null<AST::Call>(p.parseFactor());
 
     REQUIRE(fa != nullptr);
-    REQUIRE(fa->name == "f");
+    REQUIRE(fa->name.str() == "f");
     REQUIRE(fa->args.size() == 2);
   }
 }
@@ -301,7 +341,7 @@ TEST_CASE("parser can parse terms", "[parser]") {
   SECTION("parser can parse a lone factor term") {
     std::string source = "-89";
     Parser p(source);
-    auto te = dynamic_cast<AST::Literal *>(p.parseTerm());
+    auto te = llvm::dyn_cast_or_null<AST::Literal>(p.parseTerm());
 
     REQUIRE(te != nullptr);
     REQUIRE(te->value == -89);
@@ -310,7 +350,7 @@ TEST_CASE("parser can parse terms", "[parser]") {
   SECTION("parser can parse a mul-op term") {
     std::string source = "34 *   67";
     Parser p(source);
-    auto te = dynamic_cast<AST::BinaryOp *>(p.parseTerm());
+    auto te = llvm::dyn_cast_or_null<AST::BinaryOp>(p.parseTerm());
 
     REQUIRE(te != nullptr);
     REQUIRE(te->type == AST::Multiply);
@@ -319,11 +359,11 @@ TEST_CASE("parser can parse terms", "[parser]") {
   SECTION("parser won't parse an add-op") {
     std::string source = "34+67";
     Parser p(source);
-    auto te = dynamic_cast<AST::Literal *>(p.parseTerm());
+    auto te = llvm::dyn_cast_or_null<AST::Literal>(p.parseTerm());
 
     REQUIRE(te != nullptr);
     REQUIRE(te->value == 34);
-    REQUIRE(*(p.column) == '+');
+    REQUIRE(p.tokens[p.pos].type == Lex::Plus);
   }
 }
 
@@ -331,7 +371,7 @@ TEST_CASE("parser can parse expressions", "[parser]") {
   SECTION("parser can parse a lone literal expression") {
     std::string source = "-89";
     Parser p(source);
-    auto te = dynamic_cast<AST::Literal *>(p.parseExpression());
+    auto te = llvm::dyn_cast_or_null<AST::Literal>(p.parseExpression());
 
     REQUIRE(te != nullptr);
     REQUIRE(te->value == -89);
@@ -340,7 +380,7 @@ TEST_CASE("parser can parse expressions", "[parser]") {
   SECTION("parser can parse an add-op term") {
     std::string source = "34 +   67";
     Parser p(source);
-    auto te = dynamic_cast<AST::BinaryOp *>(p.parseExpression());
+    auto te = llvm::dyn_cast_or_null<AST::BinaryOp>(p.parseExpression());
 
     REQUIRE(te != nullptr);
     REQUIRE(te->type == AST::Add);
@@ -349,7 +389,7 @@ TEST_CASE("parser can parse expressions", "[parser]") {
   SECTION("parser will also parse a mul-op") {
     std::string source = "34*67";
     Parser p(source);
-    auto te = dynamic_cast<AST::BinaryOp *>(p.parseExpression());
+    auto te = llvm::dyn_cast_or_null<AST::BinaryOp>(p.parseExpression());
 
     REQUIRE(te != nullptr);
     REQUIRE(te->type == AST::Multiply);
@@ -363,7 +403,7 @@ TEST_CASE("parser can parse a dereference", "[parser]") {
     auto de = p.parseDeref();
     
     REQUIRE(de != nullptr);
-    auto lit = dynamic_cast<AST::Literal *>(de->address);
+    auto lit = llvm::dyn_cast_or_null<AST::Literal>(de->address);
     REQUIRE(lit != nullptr);
     REQUIRE(lit->value == 34);
   }
@@ -373,7 +413,8 @@ TEST_CASE("parser can parse a dereference", "[parser]") {
     Parser p(source);
     auto de = p.parseDeref();
     
-    REQUIRE(*(p.column) == 'a');
+    REQUIRE(p.tokens[p.pos].type == Lex::Identifier);
+    REQUIRE(Symbol(p.tokens[p.pos].value).str() == "a");
   }
 
   SECTION("parser fails if unbalanced") {
@@ -382,7 +423,7 @@ TEST_CASE("parser can parse a dereference", "[parser]") {
     auto de = p.parseDeref();
     
     REQUIRE(de == nullptr);
-    REQUIRE(*(p.column) == '[');
+    REQUIRE(p.tokens[p.pos].type == Lex::LeftBracket);
   }
 }
 
@@ -402,9 +443,9 @@ TEST_CASE("parser can parse expression lists", "[parser]") {
     auto list = p.parseExpressionList();
 
     REQUIRE(list.size() == 3);
-    auto first = dynamic_cast<AST::Literal *>(list[0]);
-    auto second = dynamic_cast<AST::BinaryOp *>(list[1]);
-    auto third = dynamic_cast<AST::Literal *>(list[2]);
+    auto first = llvm::dyn_cast_or_null<AST::Literal>(list[0]);
+    auto second = llvm::dyn_cast_or_null<AST::BinaryOp>(list[1]);
+    auto third = llvm::dyn_cast_or_null<AST::Literal>(list[2]);
     REQUIRE(first != nullptr);
     REQUIRE(second != nullptr);
     REQUIRE(third != nullptr);
@@ -419,9 +460,9 @@ TEST_CASE("parser can parse expression lists", "[parser]") {
     auto list = p.parseExpressionList();
 
     REQUIRE(list.size() == 1);
-    auto first = dynamic_cast<AST::Literal *>(list[0]);
+    auto first = llvm::dyn_cast_or_null<AST::Literal>(list[0]);
     REQUIRE(first->value == 1);
-    REQUIRE(*(p.column) == ',');
+    REQUIRE(p.tokens[p.pos].type == Lex::Comma);
   }
 }
 
@@ -432,7 +473,7 @@ TEST_CASE("parser can parse function calls", "[parser]") {
     auto call = p.parseCall();
 
     REQUIRE(call != nullptr);
-    REQUIRE(call->name == "func");
+    REQUIRE(call->name.str() == "func");
     REQUIRE(call->args.size() == 0);
   }
 
@@ -442,11 +483,11 @@ TEST_CASE("parser can parse function calls", "[parser]") {
     auto call = p.parseCall();
 
     REQUIRE(call != nullptr);
-    REQUIRE(call->name == "__name__");
+    REQUIRE(call->name.str() == "__name__");
     REQUIRE(call->args.size() == 2);
-    auto first = dynamic_cast<AST::Variable *>(call->args[0]);
-    auto second = dynamic_cast<AST::Literal *>(call->args[1]);
-    REQUIRE(first->name == "x");
+    auto first = llvm::dyn_cast_or_null<AST::Variable>(call->args[0]);
+    auto second = llvm::dyn_cast_or_null<AST::Literal>(call->args[1]);
+    REQUIRE(first->name.str() == "x");
     REQUIRE(second->value == 2);
   }
 
@@ -456,7 +497,7 @@ TEST_CASE("parser can parse function calls", "[parser]") {
     auto call = p.parseCall();
 
     REQUIRE(call == nullptr);
-    REQUIRE(*(p.column) == 'b');
+    REQUIRE(p.pos == 0);
   }
 }
 
@@ -467,10 +508,10 @@ TEST_CASE("parser can parse comparisons", "[parser]") {
     auto co = p.parseComparison();
 
     REQUIRE(co != nullptr);
-    auto left = dynamic_cast<AST::Variable *>(co->left);
+    auto left = llvm::dyn_cast_or_null<AST::Variable>(co->left);
     auto type = co->type;
-    auto right = dynamic_cast<AST::Literal *>(co->right);
-    REQUIRE(left->name == "name");
+    auto right = llvm::dyn_cast_or_null<AST::Literal>(co->right);
+    REQUIRE(left->name.str() == "name");
     REQUIRE(type == AST::Eq);
     REQUIRE(right->value == 13);
   }
@@ -481,10 +522,10 @@ TEST_CASE("parser can parse comparisons", "[parser]") {
     auto co = p.parseComparison();
 
     REQUIRE(co != nullptr);
-    auto left = dynamic_cast<AST::Variable *>(co->left);
+    auto left = llvm::dyn_cast_or_null<AST::Variable>(co->left);
     auto type = co->type;
-    auto right = dynamic_cast<AST::Literal *>(co->right);
-    REQUIRE(left->name == "name");
+    auto right = llvm::dyn_cast_or_null<AST::Literal>(co->right);
+    REQUIRE(left->name.str() == "name");
     REQUIRE(type == AST::Neq);
     REQUIRE(right->value == 13);
   }
@@ -502,7 +543,7 @@ TEST_CASE("parser can parse boolean factors", "[parser]") {
   SECTION("parser can parse literal factors") {
     std::string source = "true";
     Parser p(source);
-    auto fa = dynamic_cast<AST::BooleanLiteral *>(p.parseBooleanFactor());
+    auto fa = llvm::dyn_cast_or_null<AST::BooleanLiteral>(p.parseBooleanFactor());
 
     REQUIRE(fa != nullptr);
     REQUIRE(fa->value == true);
@@ -511,11 +552,11 @@ TEST_CASE("parser can parse boolean factors", "[parser]") {
   SECTION("parser can parse comparison factors") {
     std::string source = "3 = 4";
     Parser p(source);
-    auto fa = dynamic_cast<AST::BinaryOp *>(p.parseBooleanFactor());
+    auto fa = llvm::dyn_cast_or_null<AST::BinaryOp>(p.parseBooleanFactor());
 
     REQUIRE(fa != nullptr);
-    auto left = dynamic_cast<AST::Literal *>(fa->left);
-    auto right = dynamic_cast<AST::Literal *>(fa->right);
+    auto left = llvm::dyn_cast_or_null<AST::Literal>(fa->left);
+    auto right = llvm::dyn_cast_or_null<AST::Literal>(fa->right);
     REQUIRE(left->value == 3);
     REQUIRE(right->value == 4);
   }
@@ -523,7 +564,7 @@ TEST_CASE("parser can parse boolean factors", "[parser]") {
   SECTION("parser can parse parens factors") {
     std::string source = "( false  )";
     Parser p(source);
-    auto fa = dynamic_cast<AST::BooleanLiteral *>(p.parseBooleanFactor());
+    auto fa = llvm::dyn_cast_or_null<AST::BooleanLiteral>(p.parseBooleanFactor());
     
     REQUIRE(fa != nullptr);
     REQUIRE(fa->value == false);
@@ -532,10 +573,10 @@ TEST_CASE("parser can parse boolean factors", "[parser]") {
   SECTION("parser can parse negated factors") {
     std::string source = "not false";
     Parser p(source);
-    auto fa = dynamic_cast<AST::UnaryOp *>(p.parseBooleanFactor());
+    auto fa = llvm::dyn_cast_or_null<AST::UnaryOp>(p.parseBooleanFactor());
     
     REQUIRE(fa != nullptr);
-    auto op = dynamic_cast<AST::BooleanLiteral *>(fa->operand);
+    auto op = llvm::dyn_cast_or_null<AST::BooleanLiteral>(fa->operand);
     REQUIRE(op != nullptr);
     REQUIRE(op->value == false);
     REQUIRE(fa->type == AST::Not);
@@ -546,7 +587,7 @@ TEST_CASE("parser can parse boolean terms", "[parser]") {
   SECTION("parser can parse a factor term") {
     std::string source = "true";
     Parser p(source);
-    auto fa = dynamic_cast<AST::BooleanLiteral *>(p.parseBooleanTerm());
+    auto fa = llvm::dyn_cast_or_null<AST::BooleanLiteral>(p.parseBooleanTerm());
 
     REQUIRE(fa != nullptr);
     REQUIRE(fa->value == true);
@@ -555,11 +596,11 @@ TEST_CASE("parser can parse boolean terms", "[parser]") {
   SECTION("parse can parse an and term") {
     std::string source = "true and false";
     Parser p(source);
-    auto te = dynamic_cast<AST::BinaryOp *>(p.parseBooleanTerm());
+    auto te = llvm::dyn_cast_or_null<AST::BinaryOp>(p.parseBooleanTerm());
 
     REQUIRE(te != nullptr);
-    auto left = dynamic_cast<AST::BooleanLiteral *>(te->left);
-    auto right = dynamic_cast<AST::BooleanLiteral *>(te->right);
+    auto left = llvm::dyn_cast_or_null<AST::BooleanLiteral>(te->left);
+    auto right = llvm::dyn_cast_or_null<AST::BooleanLiteral>(te->right);
     REQUIRE(left != nullptr);
     REQUIRE(right != nullptr);
     REQUIRE(left->value == true);
@@ -572,7 +613,7 @@ TEST_CASE("parser can parse booleans", "[parser]") {
   SECTION("parser can parse a term boolean") {
     std::string source = "true";
     Parser p(source);
-    auto fa = dynamic_cast<AST::BooleanLiteral *>(p.parseBoolean());
+    auto fa = llvm::dyn_cast_or_null<AST::BooleanLiteral>(p.parseBoolean());
 
     REQUIRE(fa != nullptr);
     REQUIRE(fa->value == true);
@@ -581,11 +622,11 @@ TEST_CASE("parser can parse booleans", "[parser]") {
   SECTION("parser can parse an or boolean") {
     std::string source = "true or false";
     Parser p(source);
-    auto te = dynamic_cast<AST::BinaryOp *>(p.parseBoolean());
+    auto te = llvm::dyn_cast_or_null<AST::BinaryOp>(p.parseBoolean());
 
     REQUIRE(te != nullptr);
-    auto left = dynamic_cast<AST::BooleanLiteral *>(te->left);
-    auto right = dynamic_cast<AST::BooleanLiteral *>(te->right);
+    auto left = llvm::dyn_cast_or_null<AST::BooleanLiteral>(te->left);
+    auto right = llvm::dyn_cast_or_null<AST::BooleanLiteral>(te->right);
     REQUIRE(left != nullptr);
     REQUIRE(right != nullptr);
     REQUIRE(left->value == true);
@@ -601,9 +642,9 @@ TEST_CASE("parser can parse assignment", "[parser]") {
     auto as = p.parseAssign();
 
     REQUIRE(as != nullptr);
-    auto loc = dynamic_cast<AST::Variable *>(as->location);
-    REQUIRE(loc->name == "x");
-    auto value = dynamic_cast<AST::Literal *>(as->value);
+    auto loc = llvm::dyn_cast_or_null<AST::Variable>(as->location);
+    REQUIRE(loc->name.str() == "x");
+    auto value = llvm::dyn_cast_or_null<AST::Literal>(as->value);
     REQUIRE(value != nullptr);
     REQUIRE(value->value == 34);
   }
@@ -614,12 +655,12 @@ TEST_CASE("parser can parse assignment", "[parser]") {
     auto as = p.parseAssign();
 
     REQUIRE(as != nullptr);
-    auto loc = dynamic_cast<AST::Deref *>(as->location);
+    auto loc = llvm::dyn_cast_or_null<AST::Deref>(as->location);
     REQUIRE(loc != nullptr);
-    auto addr = dynamic_cast<AST::Literal *>(loc->address);
+    auto addr = llvm::dyn_cast_or_null<AST::Literal>(loc->address);
     REQUIRE(addr != nullptr);
     REQUIRE(addr->value == 56);
-    auto value = dynamic_cast<AST::Literal *>(as->value);
+    auto value = llvm::dyn_cast_or_null<AST::Literal>(as->value);
     REQUIRE(value != nullptr);
     REQUIRE(value->value == 4);
   }
@@ -629,12 +670,12 @@ TEST_CASE("parser can parse statements", "[parser]") {
   SECTION("parser can parse assign statements") {
     std::string source = "ys <- 67";
     Parser p(source);
-    auto as = dynamic_cast<AST::Assign *>(p.parseStatement());
+    auto as = llvm::dyn_cast_or_null<AST::Assign>(p.parseStatement());
 
     REQUIRE(as != nullptr);
-    auto loc = dynamic_cast<AST::Variable *>(as->location);
-    REQUIRE(loc->name == "ys");
-    auto val = dynamic_cast<AST::Literal *>(as->value);
+    auto loc = llvm::dyn_cast_or_null<AST::Variable>(as->location);
+    REQUIRE(loc->name.str() == "ys");
+    auto val = llvm::dyn_cast_or_null<AST::Literal>(as->value);
     REQUIRE(val->value == 67);
   }
 
@@ -645,10 +686,10 @@ TEST_CASE("parser can parse statements", "[parser]") {
       end
     )";
     Parser p(source);
-    auto as = dynamic_cast<AST::If *>(p.parseStatement());
+    auto as = llvm::dyn_cast_or_null<AST::If>(p.parseStatement());
 
     REQUIRE(as != nullptr);
-    auto list = dynamic_cast<AST::StatementList *>(as->trueBody);
+    auto list = llvm::dyn_cast_or_null<AST::StatementList>(as->trueBody);
     REQUIRE(list != nullptr);
     REQUIRE(list->statements.size() == 1);
     REQUIRE(as->falseBody == nullptr);
@@ -667,13 +708,13 @@ TEST_CASE("parser can parse statements", "[parser]") {
       end
     )";
     Parser p(source);
-    auto as = dynamic_cast<AST::If *>(p.parseStatement());
+    auto as = llvm::dyn_cast_or_null<AST::If>(p.parseStatement());
 
     REQUIRE(as != nullptr);
-    auto list = dynamic_cast<AST::StatementList *>(as->trueBody);
+    auto list = llvm::dyn_cast_or_null<AST::StatementList>(as->trueBody);
     REQUIRE(list != nullptr);
     REQUIRE(list->statements.size() == 1);
-    auto flist = dynamic_cast<AST::StatementList *>(as->falseBody);
+    auto flist = llvm::dyn_cast_or_null<AST::StatementList>(as->falseBody);
     REQUIRE(flist != nullptr);
     REQUIRE(flist->statements.size() == 3);
   }
@@ -686,7 +727,7 @@ TEST_CASE("parser can parse statements", "[parser]") {
     )";
 
     Parser p(source);
-    auto as = dynamic_cast<AST::WhileLoop *>(p.parseStatement());
+    auto as = llvm::dyn_cast_or_null<AST::WhileLoop>(p.parseStatement());
 
     REQUIRE(as != nullptr);
   }
@@ -694,7 +735,7 @@ TEST_CASE("parser can parse statements", "[parser]") {
   SECTION("parser can parse return statements") {
     std::string source = "return 4";
     Parser p(source);
-    auto ret = dynamic_cast<AST::Return *>(p.parseStatement());
+    auto ret = llvm::dyn_cast_or_null<AST::Return>(p.parseStatement());
 
     REQUIRE(ret != nullptr);
   }
@@ -744,9 +785,9 @@ TEST_CASE("parser can parse function declarations", "[parser]") {
     auto f = p.parseFunctionDeclaration();
 
     REQUIRE(f != nullptr);
-    REQUIRE(f->name == "fun");
+    REQUIRE(f->name.str() == "fun");
     REQUIRE(f->params.size() == 3);
-    auto body = dynamic_cast<AST::StatementList *>(f->body);
+    auto body = llvm::dyn_cast_or_null<AST::StatementList>(f->body);
     REQUIRE(body != nullptr);
     REQUIRE(body->statements.size() == 2);
   }
@@ -791,8 +832,8 @@ TEST_CASE("parser can parse programs", "[program]") {
     auto prog = p.parseProgram();
 
     REQUIRE(prog != nullptr);
-    auto funcs = dynamic_cast<AST::FunctionList *>(prog->functions);
-    auto stmts = dynamic_cast<AST::StatementList *>(prog->body);
+    auto funcs = llvm::dyn_cast_or_null<AST::FunctionList>(prog->functions);
+    auto stmts = llvm::dyn_cast_or_null<AST::StatementList>(prog->body);
     REQUIRE(funcs->functions.size() == 2);
     REQUIRE(stmts->statements.size() == 3);
   }
@@ -805,7 +846,169 @@ TEST_CASE("parser can parse returns", "[parser]") {
     AST::Return *ret = p.parseReturn();
 
     REQUIRE(ret != nullptr);
-    auto expr = dynamic_cast<AST::Literal *>(ret->value);
+    auto expr = llvm::dyn_cast_or_null<AST::Literal>(ret->value);
     REQUIRE(expr->value == 3);
   }
 }
+
+TEST_CASE("parser gives the same results when memoizing", "[parser]") {
+  SECTION("memoized parser parses nested expressions") {
+    std::string source = "1 + (2 + (3 * [4]))";
+    Parser p(source, true);
+    auto te = llvm::dyn_cast_or_null<AST::BinaryOp>(p.parseExpression());
+
+    REQUIRE(te != nullptr);
+    REQUIRE(te->type == AST::Add);
+    auto right = llvm::dyn_cast_or_null<AST::BinaryOp>(te->right);
+    REQUIRE(right != nullptr);
+    REQUIRE(right->type == AST::Add);
+    REQUIRE(p.tokens[p.pos].type == Lex::Newline);
+  }
+
+  SECTION("memoized parser backtracks over booleans") {
+    std::string source = "x = 1 or ((y < 2) and not false)";
+    Parser p(source, true);
+    auto te = llvm::dyn_cast_or_null<AST::BinaryOp>(p.parseBoolean());
+
+    REQUIRE(te != nullptr);
+    REQUIRE(te->type == AST::Or);
+    auto right = llvm::dyn_cast_or_null<AST::BinaryOp>(te->right);
+    REQUIRE(right != nullptr);
+    REQUIRE(right->type == AST::And);
+  }
+
+  SECTION("memoized parser parses a full program") {
+    std::string source = R"(
+      function f(a)
+        return [a] * [a]
+      end
+
+      x <- f(1 + (2 + 3))
+      if x > 3 or (x < 1 and true)
+        [x] <- 1
+      end
+    )";
+    Parser p(source, true);
+    auto prog = p.parseProgram();
+
+    REQUIRE(prog != nullptr);
+  }
+}
+
+TEST_CASE("parser can parse operator chains", "[parser]") {
+  SECTION("parser associates arithmetic to the left") {
+    std::string source = "1 - 2 - 3 + 4";
+    Parser p(source);
+    auto te = llvm::dyn_cast_or_null<AST::BinaryOp>(p.parseExpression());
+
+    REQUIRE(te != nullptr);
+    REQUIRE(te->type == AST::Add);
+    auto left = llvm::dyn_cast_or_null<AST::BinaryOp>(te->left);
+    REQUIRE(left != nullptr);
+    REQUIRE(left->type == AST::Subtract);
+    auto inner = llvm::dyn_cast_or_null<AST::BinaryOp>(left->left);
+    REQUIRE(inner != nullptr);
+    REQUIRE(llvm::dyn_cast_or_null<AST::Literal>(inner->left)->value == 1);
+    REQUIRE(p.tokens[p.pos].type == Lex::Newline);
+  }
+
+  SECTION("parser binds multiplication tighter than addition") {
+    std::string source = "a * b + c * d % e";
+    Parser p(source);
+    auto te = llvm::dyn_cast_or_null<AST::BinaryOp>(p.parseExpression());
+
+    REQUIRE(te != nullptr);
+    REQUIRE(te->type == AST::Add);
+    auto right = llvm::dyn_cast_or_null<AST::BinaryOp>(te->right);
+    REQUIRE(right != nullptr);
+    REQUIRE(right->type == AST::Mod);
+  }
+
+  SECTION("parser can parse long boolean chains") {
+    std::string source = "x = 1 or x = 2 and y < 3 or true";
+    Parser p(source);
+    auto te = llvm::dyn_cast_or_null<AST::BinaryOp>(p.parseBoolean());
+
+    REQUIRE(te != nullptr);
+    REQUIRE(te->type == AST::Or);
+    auto left = llvm::dyn_cast_or_null<AST::BinaryOp>(te->left);
+    REQUIRE(left != nullptr);
+    REQUIRE(left->type == AST::Or);
+    auto and_ = llvm::dyn_cast_or_null<AST::BinaryOp>(left->right);
+    REQUIRE(and_ != nullptr);
+    REQUIRE(and_->type == AST::And);
+    REQUIRE(p.tokens[p.pos].type == Lex::Newline);
+  }
+
+  SECTION("parser won't mix arithmetic and booleans") {
+    std::string source = "1 + true";
+    Parser p(source);
+    auto te = llvm::dyn_cast_or_null<AST::Literal>(p.parseExpression());
+
+    REQUIRE(te != nullptr);
+    REQUIRE(p.tokens[p.pos].type == Lex::Plus);
+  }
+
+  SECTION("parser won't chain comparisons") {
+    std::string source = "1 < 2 < 3";
+    Parser p(source);
+    auto te = llvm::dyn_cast_or_null<AST::BinaryOp>(p.parseBoolean());
+
+    REQUIRE(te != nullptr);
+    REQUIRE(te->type == AST::Lt);
+    REQUIRE(p.tokens[p.pos].type == Lex::Lt);
+  }
+
+  SECTION("parser allows parenthesised booleans and arithmetic") {
+    std::string source = "(a + 1) * 2 > 3 and (b = 1 or c = 2)";
+    Parser p(source);
+    auto te = llvm::dyn_cast_or_null<AST::BinaryOp>(p.parseBoolean());
+
+    REQUIRE(te != nullptr);
+    REQUIRE(te->type == AST::And);
+    REQUIRE(p.tokens[p.pos].type == Lex::Newline);
+  }
+}
+
+TEST_CASE("parser can parse function lists in parallel", "[parser]") {
+  std::string source;
+  for(int i = 0; i < 300; ++i) {
+    auto n = std::to_string(i);
+    source += "function f" + n + "(a, b)\n";
+    source += "  x <- a + " + n + "\n";
+    source += "  while x > b\n    if x % 2 = 0\n      x <- x / 2\n    else\n      x <- x - 1\n    end\n  end\n";
+    source += "  return x\nend\n\n";
+  }
+
+  SECTION("parser keeps declarations in source order") {
+    Parser p(source + "y <- f1(2, 3)\n");
+    p.threads = 4;
+    auto prog = p.parseProgram();
+
+    REQUIRE(prog != nullptr);
+    auto fl = llvm::dyn_cast_or_null<AST::FunctionList>(prog->functions);
+    REQUIRE(fl->functions.size() == 300);
+    for(int i = 0; i < 300; ++i) {
+      auto decl = llvm::dyn_cast_or_null<AST::FunctionDecl>(fl->functions[i]);
+      REQUIRE(decl != nullptr);
+      REQUIRE(decl->name.str() == "f" + std::to_string(i));
+    }
+    auto body = llvm::dyn_cast_or_null<AST::StatementList>(prog->body);
+    REQUIRE(body->statements.size() == 1);
+  }
+
+  SECTION("parser stops at a declaration that doesn't parse") {
+    auto broken = source + "function g(a)\n  x <- \nend\n" + source;
+    Parser p(broken);
+    p.threads = 4;
+    auto fl = p.parseFunctionList();
+
+    REQUIRE(fl->functions.size() == 300);
+    REQUIRE(p.tokens[p.pos].type == Lex::Function);
+    REQUIRE(Symbol(p.tokens[p.pos + 1].value).str() == "g");
+
+    Parser whole(broken);
+    whole.threads = 4;
+    REQUIRE(whole.parseProgram() == nullptr);
+  }
+}
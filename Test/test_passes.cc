@@ -0,0 +1,84 @@
+#include <string>
+#include <vector>
+
+#include "parser.hh"
+#include "passes.hh"
+#include "catch.hh"
+
+// Counts how many times it has been computed.
+struct Computed {
+  static int times;
+
+  Computed(AST::Program *) { ++times; }
+};
+
+int Computed::times = 0;
+
+TEST_CASE("pass manager runs passes and caches analyses", "[passes]") {
+  Parser p("x <- 1 + 2\ny <- x * 1\n");
+  auto prog = p.parseProgram();
+  REQUIRE(prog != nullptr);
+
+  AST::PassManager pm;
+  Computed::times = 0;
+
+  SECTION("passes run in the order they were added") {
+    std::vector<std::string> order;
+    pm.add("first", [&](AST::Program *, AST::PassManager &) { order.push_back("first"); return false; });
+    pm.add("second", [&](AST::Program *, AST::PassManager &) { order.push_back("second"); return false; });
+
+    REQUIRE(pm.run(prog));
+    REQUIRE((order == std::vector<std::string>{ "first", "second" }));
+  }
+
+  SECTION("analyses are kept until a pass changes the tree") {
+    auto use = [](AST::Program *program, AST::PassManager &pm) {
+      pm.get<Computed>(program);
+      return false;
+    };
+    pm.add("use", use);
+    pm.add("use again", use);
+    pm.add("change", [](AST::Program *, AST::PassManager &) { return true; });
+    pm.add("use after change", use);
+
+    REQUIRE(pm.run(prog));
+    REQUIRE(Computed::times == 2);
+  }
+
+  SECTION("the pipeline stops at the first pass with errors") {
+    bool later = false;
+    pm.add("fail", [](AST::Program *, AST::PassManager &pm) {
+      pm.errors.push_back("failed");
+      return false;
+    });
+    pm.add("later", [&](AST::Program *, AST::PassManager &) { return later = true; });
+
+    REQUIRE_FALSE(pm.run(prog));
+    REQUIRE_FALSE(later);
+    REQUIRE(pm.errors.size() == 1);
+  }
+
+  SECTION("timing records node counts around each pass") {
+    pm.timing = true;
+    pm.addStandard();
+
+    REQUIRE(pm.run(prog));
+    REQUIRE(pm.timings.size() == 2);
+    REQUIRE(pm.timings[0].name == "resolve");
+    REQUIRE(pm.timings[0].nodesBefore == pm.timings[0].nodesAfter);
+    REQUIRE(pm.timings[1].name == "fold");
+    REQUIRE(pm.timings[1].nodesAfter < pm.timings[1].nodesBefore);
+    REQUIRE(pm.timings[1].nodesAfter == AST::NodeCount(prog).nodes);
+  }
+}
+
+TEST_CASE("standard passes report semantic errors", "[passes]") {
+  Parser p("y <- x\n");
+  auto prog = p.parseProgram();
+  AST::PassManager pm;
+  pm.addStandard();
+
+  REQUIRE_FALSE(pm.run(prog));
+  REQUIRE(pm.errors.size() == 1);
+  REQUIRE(pm.errors[0] == "Undefined variable x in top level");
+}
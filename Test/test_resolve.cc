@@ -0,0 +1,151 @@
+#include <string>
+
+#include "parser.hh"
+#include "resolve.hh"
+#include "catch.hh"
+#include "fixtures.hh"
+
+static AST::FunctionDecl *function(AST::Program *prog, size_t i) {
+  return llvm::cast<AST::FunctionDecl>(llvm::cast<AST::FunctionList>(prog->functions)->functions[i]);
+}
+
+static uint32_t slot(AST::Node *node) {
+  return llvm::cast<AST::Variable>(node)->slot;
+}
+
+TEST_CASE("resolver assigns frame slots", "[resolve]") {
+  SECTION("parameters take the first slots") {
+    Parser p("function f(a, b)\n  c <- b\n  a <- c + a\n  return c\nend\n");
+    auto prog = p.parseProgram();
+    AST::Resolver r;
+
+    REQUIRE(r.resolve(prog));
+    auto f = function(prog, 0);
+    REQUIRE(f->slots == 3);
+
+    auto first = llvm::cast<AST::Assign>(statement(f->body, 0));
+    REQUIRE(slot(first->location) == 2);
+    REQUIRE(slot(first->value) == 1);
+
+    auto second = llvm::cast<AST::Assign>(statement(f->body, 1));
+    REQUIRE(slot(second->location) == 0);
+    REQUIRE(slot(llvm::cast<AST::BinaryOp>(second->value)->right) == 0);
+  }
+
+  SECTION("functions and main have separate frames") {
+    Parser p("function f(a)\n  x <- a\nend\nx <- 1\ny <- x\n");
+    auto prog = p.parseProgram();
+    AST::Resolver r;
+
+    REQUIRE(r.resolve(prog));
+    REQUIRE(function(prog, 0)->slots == 2);
+    REQUIRE(prog->slots == 2);
+    REQUIRE(slot(llvm::cast<AST::Assign>(statement(prog->body, 1))->value) == 0);
+  }
+
+  SECTION("main frame carries over between programs") {
+    Parser p("x <- 1\n");
+    Parser q("y <- 2\nz <- x + y\n");
+    auto first = p.parseProgram();
+    auto second = q.parseProgram();
+    AST::Resolver r;
+
+    REQUIRE(r.resolve(first));
+    REQUIRE(r.resolve(second));
+    REQUIRE(second->slots == 3);
+  }
+}
+
+TEST_CASE("resolver reports undefined variables", "[resolve]") {
+  SECTION("reads before assignment are reported") {
+    Parser p("function f(a)\n  b <- b + a\n  return b\nend\n");
+    AST::Resolver r;
+
+    REQUIRE_FALSE(r.resolve(p.parseProgram()));
+    REQUIRE(r.errors.size() == 1);
+    REQUIRE(r.errors[0] == "Undefined variable b in function f");
+  }
+
+  SECTION("functions can't see top level variables") {
+    Parser p("function f()\n  return x\nend\nx <- 1\nx <- x + x\n");
+    AST::Resolver r;
+
+    REQUIRE_FALSE(r.resolve(p.parseProgram()));
+    REQUIRE(r.errors.size() == 1);
+    REQUIRE(r.errors[0] == "Undefined variable x in function f");
+  }
+
+  SECTION("each undefined name is reported once") {
+    Parser p("y <- x\nz <- x * x\n");
+    AST::Resolver r;
+
+    REQUIRE_FALSE(r.resolve(p.parseProgram()));
+    REQUIRE(r.errors.size() == 1);
+    REQUIRE(r.errors[0] == "Undefined variable x in top level");
+  }
+
+  SECTION("calls to undefined functions are reported once") {
+    Parser p("function f(a)\n  return g(a)\nend\nx <- f(1) + g(2)\ny <- h()\n");
+    AST::Resolver r;
+
+    REQUIRE_FALSE(r.resolve(p.parseProgram()));
+    REQUIRE(r.errors.size() == 2);
+    REQUIRE(r.errors[0] == "Undefined function g");
+    REQUIRE(r.errors[1] == "Undefined function h");
+  }
+
+  SECTION("units of a stream can call functions defined later") {
+    Parser first("x <- f(1)\n");
+    Parser second("function f(a)\n  return a\nend\n");
+    AST::Resolver r;
+
+    REQUIRE(r.resolveUnit(first.parseProgram()));
+    REQUIRE(r.resolveUnit(second.parseProgram()));
+    REQUIRE(r.finish());
+  }
+
+  SECTION("duplicate parameters are reported") {
+    Parser p("function f(a, a)\n  return a\nend\n");
+    AST::Resolver r;
+
+    REQUIRE_FALSE(r.resolve(p.parseProgram()));
+    REQUIRE(r.errors[0] == "Duplicate parameter a in function f");
+  }
+}
+
+TEST_CASE("resolver checks functions and calls", "[resolve]") {
+  SECTION("duplicate functions are reported") {
+    Parser p("function f(a)\n  return a\nend\nfunction f(a, b)\n  return b\nend\nx <- f(1, 2)\n");
+    AST::Resolver r;
+
+    REQUIRE_FALSE(r.resolve(p.parseProgram()));
+    REQUIRE(r.errors.size() == 1);
+    REQUIRE(r.errors[0] == "Duplicate function f");
+  }
+
+  SECTION("calls with the wrong number of arguments are reported") {
+    Parser p("function g(a, b)\n  return a\nend\nx <- g(1)\n");
+    AST::Resolver r;
+
+    REQUIRE_FALSE(r.resolve(p.parseProgram()));
+    REQUIRE(r.errors.size() == 1);
+    REQUIRE(r.errors[0] == "Function g takes 2 arguments but is called with 1 in top level");
+  }
+
+  SECTION("functions can be called before they're defined") {
+    Parser p("function f(a)\n  return g(a, a)\nend\nfunction g(a, b)\n  return a + b\nend\n");
+    AST::Resolver r;
+
+    REQUIRE(r.resolve(p.parseProgram()));
+  }
+
+  SECTION("later definitions are checked against earlier calls") {
+    AST::Resolver r;
+    Parser first("x <- h(1)\n");
+    REQUIRE(r.resolveUnit(first.parseProgram()));
+
+    Parser second("function h(a, b)\n  return a\nend\n");
+    REQUIRE_FALSE(r.resolveUnit(second.parseProgram()));
+    REQUIRE(r.errors[0] == "Function h takes 2 arguments but is called with 1");
+  }
+}
@@ -0,0 +1,80 @@
+#include <map>
+#include <string>
+#include <vector>
+
+#include "scope.hh"
+#include "catch.hh"
+
+static Symbol name(int i) {
+  return Symbol::intern("scope_" + std::to_string(i));
+}
+
+TEST_CASE("scoped table binds names in nested scopes", "[scope]") {
+  ScopedTable t;
+
+  SECTION("inner bindings shadow outer ones until popped") {
+    t.bind(name(1), 10);
+    t.push();
+    t.bind(name(1), 20);
+    t.bind(name(2), 30);
+
+    REQUIRE(t.lookup(name(1))->value == 20);
+    REQUIRE(t.lookup(name(1))->depth == 1);
+    REQUIRE(t.lookup(name(2))->value == 30);
+
+    t.pop();
+
+    REQUIRE(t.lookup(name(1))->value == 10);
+    REQUIRE(t.lookup(name(1))->depth == 0);
+    REQUIRE(t.lookup(name(2)) == nullptr);
+    REQUIRE(t.size() == 1);
+  }
+
+  SECTION("rebinding in the same scope is undone once") {
+    t.bind(name(1), 1);
+    t.push();
+    t.bind(name(1), 2);
+    t.bind(name(1), 3);
+    t.pop();
+
+    REQUIRE(t.lookup(name(1))->value == 1);
+  }
+
+  SECTION("table matches a reference through growth and popping") {
+    std::vector<std::map<int, uint32_t>> reference(1);
+    auto check = [&] {
+      std::map<int, uint32_t> visible;
+      for(auto &scope : reference) {
+        for(auto &b : scope) {
+          visible[b.first] = b.second;
+        }
+      }
+
+      for(int i = 0; i < 600; ++i) {
+        auto b = t.lookup(name(i));
+        auto it = visible.find(i);
+        REQUIRE((b != nullptr) == (it != visible.end()));
+        if(b != nullptr) {
+          REQUIRE(b->value == it->second);
+        }
+      }
+      REQUIRE(t.size() == visible.size());
+    };
+
+    for(int round = 0; round < 4; ++round) {
+      t.push();
+      reference.emplace_back();
+      for(int i = round * 50; i < 600; i += round + 1) {
+        t.bind(name(i), i * 10 + round);
+        reference.back()[i] = i * 10 + round;
+      }
+      check();
+    }
+
+    for(int round = 0; round < 4; ++round) {
+      t.pop();
+      reference.pop_back();
+      check();
+    }
+  }
+}
@@ -0,0 +1,97 @@
+#include <string>
+
+#include "llvm/IR/Instructions.h"
+
+#include "compiler.hh"
+#include "parser.hh"
+#include "resolve.hh"
+#include "share.hh"
+#include "catch.hh"
+#include "fixtures.hh"
+
+static AST::Node *value(AST::Program *prog, size_t i) {
+  return llvm::cast<AST::Assign>(statement(prog->body, i))->value;
+}
+
+static AST::Program *shared(Parser &p, AST::Sharer &s) {
+  auto prog = p.parseProgram();
+  REQUIRE(prog != nullptr);
+  REQUIRE(AST::Resolver().resolve(prog));
+  s.share(prog);
+  return prog;
+}
+
+static size_t loads(llvm::Function *f) {
+  size_t count = 0;
+  for(auto &block : *f) {
+    for(auto &inst : block) {
+      count += llvm::isa<llvm::LoadInst>(inst);
+    }
+  }
+  return count;
+}
+
+TEST_CASE("sharer merges identical expressions", "[share]") {
+  AST::Sharer s;
+
+  SECTION("identical reads of memory share a node") {
+    Parser p("a <- 1\nx <- [a] * [a]\n");
+    auto mul = llvm::cast<AST::BinaryOp>(value(shared(p, s), 1));
+    REQUIRE(mul->left == mul->right);
+    REQUIRE(mul->left->shared);
+  }
+
+  SECTION("expressions are shared across statements") {
+    Parser p("a <- 1\nx <- a * 4 + 2\ny <- a * 4 - 2\n");
+    auto prog = shared(p, s);
+    auto first = llvm::cast<AST::BinaryOp>(value(prog, 1));
+    auto second = llvm::cast<AST::BinaryOp>(value(prog, 2));
+    REQUIRE(first->left == second->left);
+  }
+
+  SECTION("stores and calls separate reads of memory") {
+    Parser p("function g()\n  return 1\nend\na <- 1\nx <- [a]\n[x] <- 2\ny <- [a]\nz <- g()\nw <- [a]\n");
+    auto prog = shared(p, s);
+    REQUIRE(value(prog, 1) != value(prog, 3));
+    REQUIRE(value(prog, 3) != value(prog, 5));
+  }
+
+  SECTION("assigning a variable only separates reads of that variable") {
+    Parser p("a <- 1\nb <- 2\nx <- a + b\nb <- 3\ny <- a + b\nz <- a + 1\nw <- a + 1\n");
+    auto prog = shared(p, s);
+    auto first = llvm::cast<AST::BinaryOp>(value(prog, 2));
+    auto second = llvm::cast<AST::BinaryOp>(value(prog, 4));
+    REQUIRE(first != second);
+    REQUIRE(first->left == second->left);
+    REQUIRE(value(prog, 5) == value(prog, 6));
+  }
+
+  SECTION("nothing is shared into or out of a branch") {
+    Parser p("a <- 1\nx <- [a]\nif a > 0\n  y <- [a]\nend\nz <- [a]\n");
+    auto prog = shared(p, s);
+    auto branch = llvm::cast<AST::If>(statement(prog->body, 2));
+    auto inside = llvm::cast<AST::Assign>(statement(branch->trueBody, 0))->value;
+    REQUIRE(inside != value(prog, 1));
+    REQUIRE(value(prog, 3) != value(prog, 1));
+  }
+}
+
+TEST_CASE("codegen computes shared expressions once", "[share]") {
+  Parser p("function f(a)\n  return [a] * [a]\nend\n");
+  auto prog = p.parseProgram();
+  REQUIRE(AST::Resolver().resolve(prog));
+
+  SECTION("without sharing each read is emitted") {
+    Compiler::State state;
+    prog->functions->compile(state);
+    REQUIRE(loads(state.Mod->getFunction("f")) == 4);
+  }
+
+  SECTION("with sharing the parameter and memory are read once") {
+    AST::Sharer s;
+    s.share(prog);
+    Compiler::State state;
+    prog->functions->compile(state);
+    REQUIRE(loads(state.Mod->getFunction("f")) == 2);
+  }
+}
@@ -0,0 +1,87 @@
+#include <string>
+
+#include "parser.hh"
+#include "resolve.hh"
+#include "stack.hh"
+#include "catch.hh"
+
+static const int depth = 100000;
+
+static size_t nesting(AST::Node *node) {
+  size_t levels = 0;
+  while(auto deref = llvm::dyn_cast_or_null<AST::Deref>(node)) {
+    node = deref->address;
+    levels++;
+  }
+  return levels;
+}
+
+TEST_CASE("stack guard continues on a fresh stack", "[stack]") {
+  SECTION("fresh stack returns the result") {
+    REQUIRE(Stack::fresh([] { return 42; }) == 42);
+  }
+
+  SECTION("fresh stack has room") {
+    REQUIRE_FALSE(Stack::fresh([] { return Stack::low(); }));
+  }
+}
+
+TEST_CASE("parser handles deeply nested input", "[stack]") {
+  SECTION("parser handles deeply nested blocks") {
+    std::string source;
+    for(int i = 0; i < depth; ++i) {
+      source += i % 2 ? "while x < 1\n" : "if true\n";
+    }
+    source += "x <- 1\n";
+    for(int i = 0; i < depth; ++i) {
+      source += "end\n";
+    }
+
+    Parser p(source);
+    auto prog = p.parseProgram();
+    REQUIRE(prog != nullptr);
+
+    auto body = llvm::dyn_cast_or_null<AST::StatementList>(prog->body);
+    REQUIRE(body->statements.size() == 1);
+  }
+
+  SECTION("parser handles deeply nested parentheses") {
+    std::string source = std::string(depth, '(') + "1" + std::string(depth, ')');
+    Parser p(source);
+
+    REQUIRE(llvm::dyn_cast_or_null<AST::Literal>(p.parseExpression()) != nullptr);
+    REQUIRE(p.tokens[p.pos].type == Lex::Newline);
+  }
+
+  SECTION("parser and compiler handle deeply nested dereferences") {
+    std::string source = "x <- " + std::string(depth, '[') + "1" + std::string(depth, ']');
+    Parser p(source);
+    auto assign = llvm::dyn_cast_or_null<AST::Assign>(p.parseStatement());
+
+    REQUIRE(assign != nullptr);
+    REQUIRE(nesting(assign->value) == depth);
+
+    REQUIRE(AST::Resolver().resolveMain(assign));
+
+    Compiler::State s;
+    s.beginMain();
+    REQUIRE(assign->compile(s) != nullptr);
+  }
+
+  SECTION("compiler handles deeply nested operators") {
+    std::string source = "not (";
+    for(int i = 0; i < depth; ++i) {
+      source += "1 = 1 and not (";
+    }
+    source += "true" + std::string(depth + 1, ')');
+    Parser p(source);
+    auto b = p.parseBoolean();
+
+    REQUIRE(b != nullptr);
+    REQUIRE(p.tokens[p.pos].type == Lex::Newline);
+
+    Compiler::State s;
+    s.beginMain();
+    REQUIRE(b->compile(s) != nullptr);
+  }
+}
@@ -0,0 +1,104 @@
+#include <sstream>
+#include <string>
+
+#include "resolve.hh"
+#include "stream.hh"
+#include "catch.hh"
+
+static std::vector<std::pair<std::string, uint32_t>> units(std::string source) {
+  std::istringstream in(source);
+  UnitReader reader(in);
+
+  std::vector<std::pair<std::string, uint32_t>> result;
+  std::string unit;
+  uint32_t line;
+  while(reader.read(unit, line)) {
+    result.emplace_back(unit, line);
+  }
+  return result;
+}
+
+static std::string print(Compiler::State &s) {
+  std::string ir;
+  raw_string_ostream out(ir);
+  s.Mod->print(out, nullptr);
+  return out.str();
+}
+
+TEST_CASE("unit reader splits programs into top level units", "[stream]") {
+  SECTION("unit reader gives each function its own unit") {
+    auto u = units("function f(a)\n  if a > 1\n    return a\n  end\n  return 0\nend\n\n"
+                   "function g()\nend\nx <- f(1)\ny <- g()\n");
+
+    REQUIRE(u.size() == 3);
+    REQUIRE(u[0].second == 1);
+    REQUIRE(u[1].first == "function g()\nend\n");
+    REQUIRE(u[1].second == 8);
+    REQUIRE(u[2].first == "x <- f(1)\ny <- g()\n");
+    REQUIRE(u[2].second == 10);
+  }
+
+  SECTION("unit reader keeps blocks of statements together") {
+    std::string body = "while x < 10\n  x <- x + 1\nend\n";
+    std::string source;
+    while(source.size() < UnitReader::unitSize) {
+      source += body;
+    }
+    auto u = units(source + body);
+
+    REQUIRE(u.size() == 2);
+    REQUIRE(u[1].first == body);
+  }
+
+  SECTION("unit reader skips blank lines between units") {
+    auto u = units("\n\n  \nfunction f()\nend\n\n");
+
+    REQUIRE(u.size() == 1);
+    REQUIRE(u[0].second == 4);
+  }
+}
+
+TEST_CASE("pipeline compiles a stream", "[stream]") {
+  std::string source =
+    "function inc(address)\n  [address] <- [address] + 1\nend\n\n"
+    "function square(address)\n  [address] <- [address] * [address]\nend\n\n"
+    "x <- 0\n[x] <- 3\ninc(x)\n";
+
+  SECTION("pipeline produces the same module as a whole program") {
+    Parser p(source);
+    auto prog = p.parseProgram();
+    REQUIRE(prog != nullptr);
+
+    REQUIRE(AST::Resolver().resolve(prog));
+
+    Compiler::State whole;
+    prog->functions->compile(whole);
+    whole.beginMain();
+    prog->body->compile(whole);
+    whole.finishMain();
+
+    std::istringstream in(source);
+    Pipeline pipeline(in);
+    Compiler::State streamed;
+
+    REQUIRE(pipeline.compile(streamed));
+    REQUIRE(print(streamed) == print(whole));
+  }
+
+  SECTION("pipeline reports lines relative to the whole stream") {
+    std::istringstream in(source + "y <- \n");
+    Pipeline pipeline(in);
+
+    REQUIRE_FALSE(pipeline.parse());
+    REQUIRE(pipeline.errors.size() == 1);
+    REQUIRE(pipeline.errors[0] == "Failed to parse whole file: stopped at line 12");
+  }
+
+  SECTION("pipeline rejects functions after statements") {
+    std::istringstream in("x <- 1\nfunction f()\nend\n");
+    Pipeline pipeline(in);
+
+    REQUIRE_FALSE(pipeline.parse());
+    REQUIRE(pipeline.errors[0] == "Failed to parse whole file: stopped at line 2");
+  }
+}
@@ -0,0 +1,59 @@
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "parser.hh"
+#include "symbol.hh"
+#include "catch.hh"
+
+TEST_CASE("symbols are interned once", "[symbol]") {
+  SECTION("equal names share an id") {
+    auto a = Symbol::intern("symbol_test_a");
+    auto b = Symbol::intern(std::string("symbol_test_") + "a");
+
+    REQUIRE(a == b);
+    REQUIRE(a != Symbol::intern("symbol_test_b"));
+    REQUIRE(a.str() == "symbol_test_a");
+  }
+
+  SECTION("symbols keep their text across chunks") {
+    std::vector<Symbol> symbols;
+    for(int i = 0; i < 5000; ++i) {
+      symbols.push_back(Symbol::intern("symbol_chunk_" + std::to_string(i)));
+    }
+
+    for(int i = 0; i < 5000; ++i) {
+      REQUIRE(symbols[i].str() == "symbol_chunk_" + std::to_string(i));
+    }
+  }
+
+  SECTION("threads interning the same names agree") {
+    std::vector<std::vector<Symbol>> seen(4);
+    std::vector<std::thread> threads;
+    for(auto &s : seen) {
+      threads.emplace_back([&s] {
+        for(int i = 0; i < 2000; ++i) {
+          s.push_back(Symbol::intern("symbol_thread_" + std::to_string(i)));
+        }
+      });
+    }
+    for(auto &t : threads) {
+      t.join();
+    }
+
+    REQUIRE(seen[1] == seen[0]);
+    REQUIRE(seen[3] == seen[2]);
+    REQUIRE(seen[2] == seen[0]);
+  }
+
+  SECTION("separate parsers agree on names") {
+    Parser p("abc <- d\n");
+    Parser q("d <- abc\n");
+
+    auto a = llvm::cast<AST::Assign>(p.parseAssign());
+    auto b = llvm::cast<AST::Assign>(q.parseAssign());
+
+    REQUIRE(llvm::cast<AST::Variable>(a->location)->name ==
+            llvm::cast<AST::Variable>(b->value)->name);
+  }
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace Bench {
+
+struct Case {
+  std::string name;
+  std::function<void()> run;
+};
+
+std::vector<Case> &registry();
+
+struct Register {
+  Register(std::string name, std::function<void()> run);
+};
+
+// Wall-clock time of a single call to f, in seconds.
+template<typename F>
+double time(F &&f) {
+  auto start = std::chrono::steady_clock::now();
+  f();
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+}
+
+#define BENCH_CONCAT_(a, b) a##b
+#define BENCH_CONCAT(a, b) BENCH_CONCAT_(a, b)
+
+#define BENCHMARK(name) \
+  static void BENCH_CONCAT(benchmark_, __LINE__)(); \
+  static Bench::Register BENCH_CONCAT(register_, __LINE__)( \
+      name, BENCH_CONCAT(benchmark_, __LINE__)); \
+  static void BENCH_CONCAT(benchmark_, __LINE__)()
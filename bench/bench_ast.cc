@@ -0,0 +1,155 @@
+#include <cstdio>
+#include <string>
+
+#include "bench.hh"
+#include "flat.hh"
+#include "parser.hh"
+
+static std::string generated(int functions) {
+  std::string source;
+  for(int i = 0; i < functions; ++i) {
+    auto n = std::to_string(i);
+    source += "function f" + n + "(a, b)\n  x <- (a + " + n + ") * b - [a % 7]\n";
+    source += "  while x > b and not x = 0\n    if x % 2 = 0\n      x <- x / 2\n";
+    source += "    else\n      x <- g(x - 1, b, 3)\n    end\n  end\n  return x + 1\nend\n";
+  }
+  for(int i = 0; i < functions; ++i) {
+    source += "[" + std::to_string(i) + "] <- f" + std::to_string(i) + "(1, 2) + 3\n";
+  }
+  return source;
+}
+
+struct Totals {
+  size_t nodes;
+  size_t bytes;
+  int64_t sum;
+};
+
+// Visits every node of the pointer-linked AST, testing its kind tag
+// against each node type in turn.
+static void walk(AST::Node *node, Totals &t) {
+  if(node == nullptr) {
+    return;
+  }
+
+  t.nodes++;
+
+  if(auto lit = llvm::dyn_cast<AST::Literal>(node)) {
+    t.bytes += sizeof(*lit);
+    t.sum += lit->value;
+  } else if(auto lit = llvm::dyn_cast<AST::BooleanLiteral>(node)) {
+    t.bytes += sizeof(*lit);
+  } else if(auto var = llvm::dyn_cast<AST::Variable>(node)) {
+    t.bytes += sizeof(*var);
+  } else if(auto op = llvm::dyn_cast<AST::BinaryOp>(node)) {
+    t.bytes += sizeof(*op);
+    walk(op->left, t);
+    walk(op->right, t);
+  } else if(auto op = llvm::dyn_cast<AST::UnaryOp>(node)) {
+    t.bytes += sizeof(*op);
+    walk(op->operand, t);
+  } else if(auto deref = llvm::dyn_cast<AST::Deref>(node)) {
+    t.bytes += sizeof(*deref);
+    walk(deref->address, t);
+  } else if(auto assign = llvm::dyn_cast<AST::Assign>(node)) {
+    t.bytes += sizeof(*assign);
+    walk(assign->location, t);
+    walk(assign->value, t);
+  } else if(auto loop = llvm::dyn_cast<AST::WhileLoop>(node)) {
+    t.bytes += sizeof(*loop);
+    walk(loop->condition, t);
+    walk(loop->body, t);
+  } else if(auto branch = llvm::dyn_cast<AST::If>(node)) {
+    t.bytes += sizeof(*branch);
+    walk(branch->condition, t);
+    walk(branch->trueBody, t);
+    walk(branch->falseBody, t);
+  } else if(auto call = llvm::dyn_cast<AST::Call>(node)) {
+    t.bytes += sizeof(*call) + call->args.size() * sizeof(AST::Node *);
+    for(auto arg : call->args) {
+      walk(arg, t);
+    }
+  } else if(auto ret = llvm::dyn_cast<AST::Return>(node)) {
+    t.bytes += sizeof(*ret);
+    walk(ret->value, t);
+  } else if(auto decl = llvm::dyn_cast<AST::FunctionDecl>(node)) {
+    t.bytes += sizeof(*decl) + decl->params.size() * sizeof(Symbol);
+    walk(decl->body, t);
+  } else if(auto list = llvm::dyn_cast<AST::FunctionList>(node)) {
+    t.bytes += sizeof(*list) + list->functions.size() * sizeof(AST::Node *);
+    for(auto f : list->functions) {
+      walk(f, t);
+    }
+  } else if(auto list = llvm::dyn_cast<AST::StatementList>(node)) {
+    t.bytes += sizeof(*list) + list->statements.size() * sizeof(AST::Node *);
+    for(auto s : list->statements) {
+      walk(s, t);
+    }
+  } else if(auto prog = llvm::dyn_cast<AST::Program>(node)) {
+    t.bytes += sizeof(*prog);
+    walk(prog->functions, t);
+    walk(prog->body, t);
+  }
+}
+
+static void walk(const AST::FlatTree &tree, uint32_t node, Totals &t) {
+  if(node == AST::FlatTree::none) {
+    return;
+  }
+
+  t.nodes++;
+  if(tree.kinds[node] == AST::LiteralKind) {
+    t.sum += tree.value(node);
+  }
+
+  for(auto child : tree.children(node)) {
+    walk(tree, child, t);
+  }
+}
+
+BENCHMARK("ast: pointer tree against flat tree") {
+  auto source = generated(20000);
+  Parser p(source);
+  auto prog = p.parseProgram();
+  if(prog == nullptr) {
+    std::printf("failed to parse\n");
+    return;
+  }
+
+  Totals pointers = { 0, 0, 0 };
+  double tp = Bench::time([&] { walk(prog, pointers); });
+
+  AST::FlatTree *tree;
+  double tb = Bench::time([&] { tree = new AST::FlatTree(prog); });
+
+  Totals flat = { 0, 0, 0 };
+  double tf = Bench::time([&] { walk(*tree, 0, flat); });
+
+  // Most passes don't care about the shape of the tree at all.
+  Totals scan = { 0, 0, 0 };
+  double ts = Bench::time([&] {
+    for(uint32_t i = 0; i < tree->size(); ++i) {
+      scan.nodes++;
+      if(tree->kinds[i] == AST::LiteralKind) {
+        scan.sum += tree->value(i);
+      }
+    }
+  });
+
+  if(pointers.nodes != flat.nodes || pointers.sum != flat.sum || flat.sum != scan.sum) {
+    std::printf("trees disagree\n");
+    return;
+  }
+
+  std::printf("%zu nodes\n", flat.nodes);
+  std::printf("%-22s %10s %12s %12s\n", "", "time (ms)", "Mnodes/sec", "bytes/node");
+  std::printf("%-22s %10.2f %12.1f %12.1f\n", "pointer tree walk", tp * 1e3,
+              pointers.nodes / tp / 1e6, double(pointers.bytes) / pointers.nodes);
+  std::printf("%-22s %10.2f %12.1f %12.1f\n", "flat tree walk", tf * 1e3,
+              flat.nodes / tf / 1e6, double(tree->bytes()) / flat.nodes);
+  std::printf("%-22s %10.2f %12.1f %12s\n", "flat tree scan", ts * 1e3,
+              scan.nodes / ts / 1e6, "");
+  std::printf("%-22s %10.2f\n", "flattening", tb * 1e3);
+
+  delete tree;
+}
@@ -0,0 +1,57 @@
+#include <cstdio>
+#include <memory>
+#include <string>
+
+#include <unistd.h>
+
+#include "bench.hh"
+#include "cache.hh"
+#include "parser.hh"
+
+static std::string generated(int functions) {
+  std::string source;
+  for(int i = 0; i < functions; ++i) {
+    auto n = std::to_string(i);
+    source += "function f" + n + "(a, b)\n  x <- (a + " + n + ") * b - [a % 7]\n";
+    source += "  while x > b and not x = 0\n    if x % 2 = 0\n      x <- x / 2\n";
+    source += "    else\n      x <- g(x - 1, b, 3)\n    end\n  end\n  return x + 1\nend\n";
+  }
+  for(int i = 0; i < functions; ++i) {
+    source += "[" + std::to_string(i) + "] <- f" + std::to_string(i) + "(1, 2) + 3\n";
+  }
+  return source;
+}
+
+BENCHMARK("cache: parse against loading a saved program") {
+  auto source = generated(40000);
+  auto path = std::string(P_tmpdir) + "/pbc_bench_" + std::to_string(getpid()) + ".ast";
+
+  AST::CachedProgram::Key key;
+  double hash = Bench::time([&] { key = AST::CachedProgram::Key::of(source); });
+
+  AST::Program *prog = nullptr;
+  std::unique_ptr<Parser> p;
+  double parse = Bench::time([&] {
+    p = std::make_unique<Parser>(source);
+    prog = p->parseProgram();
+  });
+
+  AST::FlatTree tree(prog);
+  double store = Bench::time([&] { AST::CachedProgram::store(path, key, tree); });
+
+  bool loaded = false;
+  double load = Bench::time([&] { loaded = AST::CachedProgram::load(path, key) != nullptr; });
+  std::remove(path.c_str());
+
+  if(!loaded) {
+    std::printf("failed to load\n");
+    return;
+  }
+
+  std::printf("%.1f MB of source, %zu nodes\n", source.size() / 1e6, tree.size());
+  std::printf("%-24s %10s\n", "stage", "time (ms)");
+  std::printf("%-24s %10.2f\n", "hash source", hash * 1e3);
+  std::printf("%-24s %10.2f\n", "lex and parse", parse * 1e3);
+  std::printf("%-24s %10.2f\n", "save image", store * 1e3);
+  std::printf("%-24s %10.2f\n", "load image", load * 1e3);
+}
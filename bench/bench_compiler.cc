@@ -0,0 +1,179 @@
+#include <cstdio>
+#include <string>
+#include <utility>
+
+#include "bench.hh"
+#include "compiler.hh"
+#include "flat.hh"
+#include "fold.hh"
+#include "parser.hh"
+#include "passes.hh"
+#include "resolve.hh"
+#include "share.hh"
+
+// Straight-line code over parameters and memory, which the compiler
+// handles completely today.
+static std::string generated(int functions) {
+  std::string source;
+  for(int i = 0; i < functions; ++i) {
+    auto n = std::to_string(i);
+    source += "function f" + n + "(a, b)\n";
+    source += "  [a] <- [b] + a * " + n + " - (b % 7)\n";
+    source += "  [b + 1] <- [a] * [a - 1] / (b + 2)\n";
+    if(i > 0) {
+      source += "  [a + b] <- f" + std::to_string(i - 1) + "(a + 1, [b]) + [a]\n";
+    }
+    source += "  return [a] + [b] * 2\nend\n";
+  }
+  source += "[0] <- f" + std::to_string(functions - 1) + "(1, 2)\n";
+  return source;
+}
+
+BENCHMARK("compiler: codegen throughput") {
+  auto source = generated(20000);
+  Parser p(source);
+  auto prog = p.parseProgram();
+  if(prog == nullptr) {
+    std::printf("failed to parse\n");
+    return;
+  }
+
+  auto nodes = AST::FlatTree(prog).size();
+
+  double r = Bench::time([&] { AST::Resolver().resolve(prog); });
+
+  Compiler::State s;
+  double t = Bench::time([&] {
+    prog->functions->compile(s);
+    s.beginMain();
+    prog->body->compile(s);
+    s.finishMain();
+  });
+
+  std::printf("%zu nodes\n", nodes);
+  std::printf("%-10s %12s %14s\n", "stage", "time (ms)", "Mnodes/sec");
+  std::printf("%-10s %12.2f %14.2f\n", "resolve", r * 1e3, nodes / r / 1e6);
+  std::printf("%-10s %12.2f %14.2f\n", "codegen", t * 1e3, nodes / t / 1e6);
+}
+
+// Functions of the given number of locals, each of which is assigned from
+// the one before and read a few times.
+static std::string locals(int functions, int count) {
+  std::string source;
+  for(int f = 0; f < functions; ++f) {
+    source += "function g" + std::to_string(f) + "(a)\n  v0 <- a\n";
+    for(int i = 1; i < count; ++i) {
+      auto prev = "v" + std::to_string(i - 1);
+      source += "  v" + std::to_string(i) + " <- " + prev + " * 3 + " + prev + " - a\n";
+    }
+    source += "  return v" + std::to_string(count - 1) + "\nend\n";
+  }
+  return source;
+}
+
+BENCHMARK("compiler: functions with many locals") {
+  std::printf("%10s %10s %12s %12s\n", "functions", "locals", "resolve (ms)", "codegen (ms)");
+
+  for(auto shape : { std::make_pair(1, 20000), std::make_pair(100, 200), std::make_pair(4000, 5) }) {
+    auto source = locals(shape.first, shape.second);
+    Parser p(source);
+    auto prog = p.parseProgram();
+    if(prog == nullptr) {
+      std::printf("failed to parse\n");
+      return;
+    }
+
+    double r = Bench::time([&] { AST::Resolver().resolve(prog); });
+
+    Compiler::State s;
+    double t = Bench::time([&] { prog->functions->compile(s); });
+
+    std::printf("%10d %10d %12.2f %12.2f\n", shape.first, shape.second, r * 1e3, t * 1e3);
+  }
+}
+
+// Functions full of arithmetic on constants, identities and a branch that
+// never runs, as other programs tend to generate.
+static std::string constants(int functions) {
+  std::string source;
+  for(int i = 0; i < functions; ++i) {
+    source += "function c" + std::to_string(i) + "(a, b)\n";
+    source += "  [a] <- a * 1 + 0 + (4 * 8 - 32) * b + [b - 0]\n";
+    source += "  x <- (a + 0) * (1 * b) + 60 / (2 + 3) - 12\n";
+    source += "  if 2 > 3 and not not b > 1\n    [b] <- x * 2\n  end\n";
+    source += "  return x * 1\nend\n";
+  }
+  return source;
+}
+
+static size_t instructions(Module &m) {
+  size_t count = 0;
+  for(auto &f : m) {
+    count += f.getInstructionCount();
+  }
+  return count;
+}
+
+BENCHMARK("compiler: constant folding") {
+  auto source = constants(20000);
+  std::printf("%-10s %10s %14s %14s\n", "tree", "fold (ms)", "codegen (ms)", "instructions");
+
+  for(bool folding : { false, true }) {
+    Parser p(source);
+    auto prog = p.parseProgram();
+    if(prog == nullptr) {
+      std::printf("failed to parse\n");
+      return;
+    }
+
+    AST::Resolver().resolve(prog);
+
+    AST::Folder folder;
+    double f = folding ? Bench::time([&] { folder.fold(prog); }) : 0;
+
+    Compiler::State s;
+    double t = Bench::time([&] { prog->functions->compile(s); });
+
+    std::printf("%-10s %10.2f %14.2f %14zu\n", folding ? "folded" : "as parsed", f * 1e3, t * 1e3,
+                instructions(*s.Mod));
+  }
+}
+
+// Functions that read the same memory and index arithmetic several times
+// between stores.
+static std::string repeated(int functions) {
+  std::string source;
+  for(int i = 0; i < functions; ++i) {
+    source += "function r" + std::to_string(i) + "(a, b)\n";
+    source += "  x <- [b] * [b] + [b + 1] * [b + 1]\n";
+    source += "  y <- [b + 1] - [b] + x * x\n";
+    source += "  [a] <- x + y + [a + b]\n";
+    source += "  return [a + b] * [a] + (x * x)\nend\n";
+  }
+  return source;
+}
+
+BENCHMARK("compiler: shared subexpressions") {
+  auto source = repeated(20000);
+  std::printf("%-10s %10s %10s %14s %14s\n", "tree", "nodes", "share (ms)", "codegen (ms)", "instructions");
+
+  for(bool sharing : { false, true }) {
+    Parser p(source);
+    auto prog = p.parseProgram();
+    if(prog == nullptr) {
+      std::printf("failed to parse\n");
+      return;
+    }
+
+    AST::Resolver().resolve(prog);
+
+    AST::Sharer sharer;
+    double h = sharing ? Bench::time([&] { sharer.share(prog); }) : 0;
+
+    Compiler::State s;
+    double t = Bench::time([&] { prog->functions->compile(s); });
+
+    std::printf("%-10s %10zu %10.2f %14.2f %14zu\n", sharing ? "shared" : "as parsed", AST::NodeCount(prog).nodes,
+                h * 1e3, t * 1e3, instructions(*s.Mod));
+  }
+}
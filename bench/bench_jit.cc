@@ -0,0 +1,148 @@
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Program.h"
+
+#include "bench.hh"
+#include "compiler.hh"
+#include "emit.hh"
+#include "jit.hh"
+#include "optimize.hh"
+#include "parser.hh"
+#include "passes.hh"
+#include "source.hh"
+
+using namespace llvm;
+
+static const char *programs[] = {
+  "func.pb", "parse/funcs.pb", "parse/loop.pb", "kernel.pb"
+};
+
+static const std::pair<const char *, OptimizationLevel> levels[] = {
+  { "-O0", OptimizationLevel::O0 },
+  { "-O2", OptimizationLevel::O2 }
+};
+
+// Parses, resolves, folds and compiles the source into s.
+static bool compile(std::string_view source, OptimizationLevel level, TargetMachine *machine,
+                    Compiler::State &s) {
+  Parser p(source);
+  auto prog = p.parseProgram();
+  AST::PassManager passes;
+  passes.addStandard();
+  if(prog == nullptr || !passes.run(prog)) {
+    return false;
+  }
+
+  prog->compile(s);
+  Compiler::optimize(*s.Mod, level, machine);
+  return true;
+}
+
+// Time to first result is everything after the source is read: compiling,
+// then either running in the JIT, or linking an executable and running that
+// as a child process.
+BENCHMARK("jit: time to first result against an executable") {
+  std::string error;
+  auto machine = Compiler::hostMachine(error);
+  if(machine == nullptr) {
+    std::printf("no target for the host: %s\n", error.c_str());
+    return;
+  }
+
+  SmallString<128> exe;
+  if(sys::fs::createTemporaryFile("pbc", "", exe)) {
+    std::printf("no temporary file for the executable\n");
+    return;
+  }
+
+  std::printf("%-16s %6s %10s %10s %8s %8s\n", "program", "level", "jit (ms)", "aot (ms)", "jit", "aot");
+
+  for(auto name : programs) {
+    auto source = SourceFile::open(std::string(EXAMPLES_DIR "/") + name);
+    if(source == nullptr) {
+      std::printf("%-16s could not be read\n", name);
+      continue;
+    }
+
+    for(auto &level : levels) {
+      int jitResult = -1, aotResult = -1;
+      bool ok = true;
+
+      double jit = Bench::time([&] {
+        Compiler::State s;
+        ok = ok && compile(source->text(), level.second, machine.get(), s) &&
+             Compiler::run(s, jitResult, error);
+      });
+
+      double aot = Bench::time([&] {
+        Compiler::State s;
+        ok = ok && compile(source->text(), level.second, machine.get(), s) &&
+             Compiler::emitExecutable(*s.Mod, *machine, exe.str().str(), error);
+        if(ok) {
+          StringRef args[] = { exe };
+          aotResult = sys::ExecuteAndWait(exe, args);
+        }
+      });
+
+      if(!ok) {
+        std::printf("%-16s failed: %s\n", name, error.c_str());
+        break;
+      }
+
+      std::printf("%-16s %6s %10.2f %10.2f %8d %8d\n", name, level.first, jit * 1e3, aot * 1e3,
+                  jitResult & 0xff, aotResult);
+    }
+  }
+
+  sys::fs::remove(exe);
+}
+
+// Many functions, of which main only calls the first few.
+static std::string wide(int functions, int called) {
+  std::string source;
+  for(int i = 0; i < functions; ++i) {
+    auto n = std::to_string(i);
+    source += "function f" + n + "(a)\n  while a < " + n + "\n    a <- a + 1\n  end\n  return a\nend\n";
+  }
+
+  for(int i = 0; i < called; ++i) {
+    source += "[0] <- [0] + f" + std::to_string(i) + "(0)\n";
+  }
+  return source;
+}
+
+// The optimizer still sees the whole module up front, so this is at -O0,
+// where nearly all the cost is in codegen.
+BENCHMARK("jit: eager against lazy compilation of a large program") {
+  std::printf("%10s %8s %12s %12s %8s %8s\n", "functions", "called", "eager (ms)", "lazy (ms)", "eager", "lazy");
+
+  for(int functions : { 100, 1000, 5000 }) {
+    auto source = wide(functions, 4);
+    int eagerResult = -1, lazyResult = -1;
+    std::string error;
+    bool ok = true;
+
+    double eager = Bench::time([&] {
+      Compiler::State s;
+      ok = ok && compile(source, OptimizationLevel::O0, nullptr, s) && Compiler::run(s, eagerResult, error);
+    });
+
+    double lazy = Bench::time([&] {
+      Compiler::State s;
+      ok = ok && compile(source, OptimizationLevel::O0, nullptr, s) &&
+           Compiler::run(s, lazyResult, error, true);
+    });
+
+    if(!ok) {
+      std::printf("%10d failed: %s\n", functions, error.c_str());
+      continue;
+    }
+
+    std::printf("%10d %8d %12.2f %12.2f %8d %8d\n", functions, 4, eager * 1e3, lazy * 1e3, eagerResult,
+                lazyResult);
+  }
+}
@@ -0,0 +1,41 @@
+#include <cstdio>
+#include <string>
+
+#include "bench.hh"
+#include "lexer.hh"
+#include "structure.hh"
+
+static std::string generated(size_t lines) {
+  std::string source;
+  for(size_t i = 0; i < lines; ++i) {
+    source += "  x" + std::to_string(i % 50) + " <- [x" + std::to_string(i % 37) +
+              " + " + std::to_string(i) + "] * 3 + y - " + std::to_string(i % 7) + "\n";
+  }
+  return source;
+}
+
+BENCHMARK("lexer: structural index and tokens") {
+  auto source = generated(1000000);
+  double mb = source.size() / 1e6;
+
+  const char *names[] = { "scalar", "sse2", "avx2" };
+  auto kernels = {
+    Lex::StructuralIndexer::Scalar,
+    Lex::StructuralIndexer::SSE2,
+    Lex::StructuralIndexer::AVX2
+  };
+
+  std::printf("%.1f MB of source\n", mb);
+  std::printf("%-20s %10s %10s\n", "stage", "time (ms)", "MB/s");
+
+  for(auto k : kernels) {
+    Lex::StructuralIndexer indexer(k);
+    std::vector<uint32_t> starts(source.size());
+
+    double t = Bench::time([&] { indexer.index(source, 0, source.size(), starts.data()); });
+    std::printf("index (%-6s)       %10.2f %10.0f\n", names[k], t * 1e3, mb / t);
+  }
+
+  double t = Bench::time([&] { Lex::Lexer l(source); });
+  std::printf("%-20s %10.2f %10.0f\n", "full lexer", t * 1e3, mb / t);
+}
@@ -0,0 +1,36 @@
+#include <cstring>
+#include <iostream>
+
+#include "bench.hh"
+
+namespace Bench {
+
+std::vector<Case> &registry() {
+  static std::vector<Case> cases;
+  return cases;
+}
+
+Register::Register(std::string name, std::function<void()> run) {
+  registry().push_back({ name, run });
+}
+
+}
+
+// Runs every registered benchmark, or only those whose name contains one of
+// the command line arguments.
+int main(int argc, char *argv[]) {
+  for(auto &c : Bench::registry()) {
+    bool selected = argc < 2;
+    for(int i = 1; i < argc; ++i) {
+      selected |= c.name.find(argv[i]) != std::string::npos;
+    }
+
+    if(selected) {
+      std::cout << "== " << c.name << std::endl;
+      c.run();
+      std::cout << std::endl;
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,79 @@
+#include <cstdio>
+#include <string>
+#include <utility>
+
+#include "llvm/ExecutionEngine/Orc/LLJIT.h"
+
+#include "bench.hh"
+#include "compiler.hh"
+#include "optimize.hh"
+#include "parser.hh"
+#include "passes.hh"
+#include "source.hh"
+
+using namespace llvm;
+
+// Only kernel.pb runs for long enough for the levels to matter much; the
+// rest show what each level costs on programs that barely run at all.
+static const char *programs[] = {
+  "func.pb", "parse/funcs.pb", "parse/ifs.pb", "parse/loop.pb", "kernel.pb"
+};
+
+static const std::pair<const char *, OptimizationLevel> levels[] = {
+  { "-O0", OptimizationLevel::O0 },
+  { "-O1", OptimizationLevel::O1 },
+  { "-O2", OptimizationLevel::O2 },
+  { "-O3", OptimizationLevel::O3 },
+  { "-Os", OptimizationLevel::Os }
+};
+
+BENCHMARK("optimize: run time of the examples at each level") {
+  std::string error;
+  auto machine = Compiler::hostMachine(error);
+  if(machine == nullptr) {
+    std::printf("no target for the host: %s\n", error.c_str());
+    return;
+  }
+
+  std::printf("%-16s %6s %14s %12s %8s\n", "program", "level", "optimize (ms)", "run (ms)", "result");
+
+  for(auto name : programs) {
+    auto source = SourceFile::open(std::string(EXAMPLES_DIR "/") + name);
+    if(source == nullptr) {
+      std::printf("%-16s could not be read\n", name);
+      continue;
+    }
+
+    for(auto &level : levels) {
+      Parser p(source->text());
+      auto prog = p.parseProgram();
+      AST::PassManager passes;
+      passes.addStandard();
+      if(prog == nullptr || !passes.run(prog)) {
+        std::printf("%-16s failed to compile\n", name);
+        break;
+      }
+
+      // The JIT takes the context over from the state, so it has to be
+      // destroyed after it.
+      auto jit = cantFail(orc::LLJITBuilder().create());
+      Compiler::State s;
+      prog->compile(s);
+
+      double o = Bench::time([&] { Compiler::optimize(*s.Mod, level.second, machine.get()); });
+
+      orc::ThreadSafeModule module(std::move(s.Mod), orc::ThreadSafeContext(std::move(s.context)));
+      cantFail(jit->addIRModule(std::move(module)));
+      auto main = reinterpret_cast<int (*)(int, char **)>(cantFail(jit->lookup("main")).getAddress());
+
+      int result = 0;
+      double best = 0;
+      for(int i = 0; i < 3; ++i) {
+        double t = Bench::time([&] { result = main(0, nullptr); });
+        best = i == 0 || t < best ? t : best;
+      }
+
+      std::printf("%-16s %6s %14.2f %12.3f %8d\n", name, level.first, o * 1e3, best * 1e3, result);
+    }
+  }
+}
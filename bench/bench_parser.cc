@@ -0,0 +1,154 @@
+#include <algorithm>
+#include <cstdio>
+#include <string>
+
+#include "bench.hh"
+#include "incremental.hh"
+#include "parser.hh"
+
+// 1 + (1 + (1 + ... )): every level offers an operator that the term rule
+// rejects after parsing its right hand side, so the same span is parsed
+// again by the expression rule.
+static std::string nestedExpression(int depth) {
+  std::string source;
+  for(int i = 0; i < depth; ++i) {
+    source += "1 + (";
+  }
+  source += "1";
+  source += std::string(depth, ')');
+  return source;
+}
+
+static std::string nestedBoolean(int depth) {
+  std::string source;
+  for(int i = 0; i < depth; ++i) {
+    source += "x = 1 or (";
+  }
+  source += "true";
+  source += std::string(depth, ')');
+  return source;
+}
+
+// The plain parser is only run until a single parse takes longer than a
+// second; past that point it grows too quickly to be worth waiting for.
+template<typename F>
+static void nesting(F generate, AST::Node *(Parser::* rule)()) {
+  std::printf("%8s %14s %14s\n", "depth", "plain (ms)", "memoized (ms)");
+
+  bool runPlain = true;
+  for(int depth = 2; depth <= 4096; depth = depth < 24 ? depth + 2 : depth * 4) {
+    auto source = generate(depth);
+
+    Parser memo(source, true);
+    double m = Bench::time([&] { (memo.*rule)(); });
+
+    if(runPlain) {
+      Parser plain(source);
+      double p = Bench::time([&] { (plain.*rule)(); });
+      runPlain = p < 1.0;
+
+      std::printf("%8d %14.3f %14.3f\n", depth, p * 1e3, m * 1e3);
+    } else {
+      std::printf("%8d %14s %14.3f\n", depth, "-", m * 1e3);
+    }
+  }
+}
+
+BENCHMARK("parser: nested arithmetic") {
+  nesting(nestedExpression, &Parser::parseExpression);
+}
+
+BENCHMARK("parser: nested booleans") {
+  nesting(nestedBoolean, &Parser::parseBoolean);
+}
+
+static std::string chain(int terms, const char *ops[], int count) {
+  std::string source = "1";
+  for(int i = 1; i < terms; ++i) {
+    source += " ";
+    source += ops[i % count];
+    source += " ";
+    source += std::to_string(i);
+  }
+  return source;
+}
+
+BENCHMARK("parser: long operator chains") {
+  const char *arithmetic[] = { "+", "*", "-", "/", "%" };
+
+  std::printf("%8s %12s %16s\n", "terms", "time (ms)", "terms/sec");
+  for(int terms = 10000; terms <= 1000000; terms *= 10) {
+    auto source = chain(terms, arithmetic, 5);
+    Parser p(source);
+
+    AST::Node *result;
+    double t = Bench::time([&] { result = p.parseExpression(); });
+    if(result == nullptr || p.tokens[p.pos].type != Lex::Newline) {
+      std::printf("failed to parse %d terms\n", terms);
+      return;
+    }
+
+    std::printf("%8d %12.3f %16.0f\n", terms, t * 1e3, terms / t);
+  }
+}
+
+BENCHMARK("parser: parallel function declarations") {
+  std::string source;
+  for(int i = 0; i < 20000; ++i) {
+    auto n = std::to_string(i);
+    source += "function f" + n + "(a, b)\n";
+    source += "  x <- (a + " + n + ") * b - [a % 7]\n";
+    source += "  while x > b and not x = 0\n    if x % 2 = 0\n      x <- x / 2\n    else\n      x <- g(x - 1, b)\n    end\n  end\n";
+    source += "  return x\nend\n";
+  }
+
+  std::printf("%8s %12s %16s\n", "threads", "time (ms)", "functions/sec");
+  for(unsigned threads : { 1u, 2u, 4u, 8u, 0u }) {
+    Parser p(source);
+    p.threads = threads;
+
+    AST::FunctionList *result;
+    double t = Bench::time([&] { result = p.parseFunctionList(); });
+    if(result->functions.size() != 20000) {
+      std::printf("failed to parse all functions\n");
+      return;
+    }
+
+    std::printf("%8s %12.3f %16.0f\n", threads ? std::to_string(threads).c_str() : "auto",
+                t * 1e3, 20000 / t);
+  }
+}
+
+BENCHMARK("parser: incremental single-line edit") {
+  std::string source;
+  for(int i = 0; i < 10000; ++i) {
+    auto n = std::to_string(i);
+    source += "function f" + n + "(a, b)\n  x <- (a + " + n + ") * b\n";
+    source += "  while x > b\n    if x % 2 = 0\n      x <- x / 2\n    else\n      x <- x - 1\n    end\n  end\n";
+    source += "  return x\nend\n";
+  }
+  for(int i = 0; i < 10000; ++i) {
+    source += "[" + std::to_string(i) + "] <- f" + std::to_string(i) + "(1, 2)\n";
+  }
+
+  IncrementalParser ip(source);
+  double whole = Bench::time([&] { Parser p(source); p.parseProgram(); });
+
+  // Alternately rewrites a literal in the middle function and puts it back.
+  auto at = source.find("(a + 5000)") + 5;
+  const int edits = 1000;
+  double t = Bench::time([&] {
+    for(int i = 0; i < edits; ++i) {
+      ip.apply({ at, 4, i % 2 ? "5000" : "4999" });
+    }
+  });
+
+  if(ip.program() == nullptr || ip.source() != source) {
+    std::printf("incremental parse failed\n");
+    return;
+  }
+
+  std::printf("%8s %14s %16s\n", "lines", "whole (ms)", "per edit (ms)");
+  std::printf("%8zu %14.3f %16.4f\n", std::count(source.begin(), source.end(), '\n'),
+              whole * 1e3, t * 1e3 / edits);
+}
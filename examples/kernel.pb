@@ -0,0 +1,26 @@
+function fill(n)
+  i <- 0
+  while i < n
+    [i] <- (i * 7 + 3) % 13
+    i <- i + 1
+  end
+end
+
+function sum(n)
+  i <- 0
+  total <- 0
+  while i < n
+    total <- total + [i] * [i]
+    i <- i + 1
+  end
+  return total
+end
+
+round <- 0
+[1023] <- 0
+while round < 20000
+  fill(1000)
+  [1023] <- ([1023] + sum(1000)) % 7919
+  round <- round + 1
+end
+[0] <- [1023] % 256
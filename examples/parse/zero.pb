@@ -0,0 +1,16 @@
+i <- 1
+while i < 200
+  [i] <- i
+  i <- i + 1
+end
+i <- 1
+while i < 200
+  [i + 200] <- [i]
+  i <- i + 1
+end
+i <- 1
+while i < 200
+  [i] <- 0
+  i <- i + 1
+end
+[0] <- [250] + [1] + 7
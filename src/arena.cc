@@ -0,0 +1,77 @@
+#include <algorithm>
+#include <cstdlib>
+
+#include "arena.hh"
+
+namespace AST {
+
+Arena::Arena() :
+  current(0)
+{
+  auto data = static_cast<char *>(std::malloc(blockSize));
+  if(data == nullptr) {
+    throw std::bad_alloc();
+  }
+
+  blocks.push_back({ data, blockSize });
+  top = data;
+  end = data + blockSize;
+}
+
+Arena::~Arena() {
+  for(auto &b : blocks) {
+    std::free(b.data);
+  }
+  for(auto &b : adopted) {
+    std::free(b.data);
+  }
+}
+
+void *Arena::allocate(size_t size, size_t align) {
+  auto aligned = (reinterpret_cast<uintptr_t>(top) + align - 1) & ~(align - 1);
+  if(aligned + size > reinterpret_cast<uintptr_t>(end)) {
+    next(size + align);
+    aligned = (reinterpret_cast<uintptr_t>(top) + align - 1) & ~(align - 1);
+  }
+
+  top = reinterpret_cast<char *>(aligned + size);
+  return reinterpret_cast<void *>(aligned);
+}
+
+// Moves on to the next free block, or a new one if that isn't big enough.
+void Arena::next(size_t size) {
+  current++;
+
+  if(current == blocks.size() || blocks[current].size < size) {
+    auto bytes = std::max(blockSize, size);
+    auto data = static_cast<char *>(std::malloc(bytes));
+    if(data == nullptr) {
+      throw std::bad_alloc();
+    }
+    blocks.insert(blocks.begin() + current, { data, bytes });
+  }
+
+  top = blocks[current].data;
+  end = top + blocks[current].size;
+}
+
+Arena::Checkpoint Arena::checkpoint() const {
+  return { current, top };
+}
+
+void Arena::rollback(Checkpoint c) {
+  current = c.block;
+  top = c.top;
+  end = blocks[current].data + blocks[current].size;
+}
+
+void Arena::adopt(Arena &other) {
+  adopted.insert(adopted.end(), other.blocks.begin(), other.blocks.end());
+  adopted.insert(adopted.end(), other.adopted.begin(), other.adopted.end());
+
+  other.blocks.clear();
+  other.adopted.clear();
+  other.top = other.end = nullptr;
+}
+
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "llvm/ADT/ArrayRef.h"
+
+namespace AST {
+
+// Bump allocator owning the nodes of a parse. Nodes only hold pointers to
+// each other, views of arrays in the arena and Symbols, which are ids into
+// the global symbol table, so they are never destroyed one at a time: the
+// blocks are released all at once with the arena.
+struct Arena {
+  static constexpr size_t blockSize = 64 * 1024;
+
+  // Position to roll back to. Everything allocated after it is reclaimed by
+  // rollback(), and later allocations reuse the space.
+  struct Checkpoint {
+    size_t block;
+    char *top;
+  };
+
+  Arena();
+  ~Arena();
+
+  Arena(const Arena &) = delete;
+  Arena &operator=(const Arena &) = delete;
+
+  void *allocate(size_t size, size_t align);
+
+  template<typename T, typename... Args>
+  T *make(Args &&... args) {
+    return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+  }
+
+  template<typename T>
+  llvm::ArrayRef<T> copy(llvm::ArrayRef<T> items) {
+    if(items.empty()) {
+      return {};
+    }
+
+    auto data = static_cast<T *>(allocate(sizeof(T) * items.size(), alignof(T)));
+    std::uninitialized_copy(items.begin(), items.end(), data);
+    return { data, items.size() };
+  }
+
+  Checkpoint checkpoint() const;
+  void rollback(Checkpoint c);
+
+  // Takes over everything allocated in other, which can't be used again.
+  void adopt(Arena &other);
+
+private:
+  struct Block {
+    char *data;
+    size_t size;
+  };
+
+  // blocks[current] is being filled, and those after it are free.
+  std::vector<Block> blocks;
+  std::vector<Block> adopted;
+  size_t current;
+  char *top;
+  char *end;
+
+  void next(size_t size);
+};
+
+}
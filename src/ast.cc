@@ -4,38 +4,39 @@ using namespace llvm;
 
 namespace AST {
 
-Literal::Literal(int32_t v) : value(v) {}
+Literal::Literal(int32_t v) : Node(LiteralKind), value(v) {}
 
-BooleanLiteral::BooleanLiteral(bool v) : value(v) {}
+BooleanLiteral::BooleanLiteral(bool v) : Node(BooleanLiteralKind), value(v) {}
 
-Variable::Variable(std::string n) : name(n) {}
+Variable::Variable(Symbol n) : Node(VariableKind), name(n), slot(unresolved) {}
 
 BinaryOp::BinaryOp(Node *l, BinaryOpType t, Node *r) :
-  left(l), type(t), right(r) {}
+  Node(BinaryOpKind), left(l), type(t), right(r) {}
 
 UnaryOp::UnaryOp(UnaryOpType t, Node *op) :
-  type(t), operand(op) {}
+  Node(UnaryOpKind), type(t), operand(op) {}
 
-Deref::Deref(Node *a) : address(a) {}
+Deref::Deref(Node *a) : Node(DerefKind), address(a) {}
 
-Assign::Assign(Node *l, Node *v) : location(l), value(v) {}
+Assign::Assign(Node *l, Node *v) : Node(AssignKind), location(l), value(v) {}
 
-WhileLoop::WhileLoop(Node *c, Node *b) : condition(c), body(b) {}
+WhileLoop::WhileLoop(Node *c, Node *b) : Node(WhileLoopKind), condition(c), body(b) {}
 
-If::If(Node *c, Node *t, Node* f) : condition(c), trueBody(t), falseBody(f) {}
-If::If(Node *c, Node *t) : condition(c), trueBody(t), falseBody(nullptr) {}
+If::If(Node *c, Node *t, Node* f) : Node(IfKind), condition(c), trueBody(t), falseBody(f) {}
+If::If(Node *c, Node *t) : Node(IfKind), condition(c), trueBody(t), falseBody(nullptr) {}
 
-Call::Call(std::string n, std::vector<Node *> a) : name(n), args(a) {}
+Call::Call(Symbol n, ArrayRef<Node *> a) : Node(CallKind), name(n), args(a) {}
 
-Return::Return(Node *v) : value(v) {}
+Return::Return(Node *v) : Node(ReturnKind), value(v) {}
 
-FunctionDecl::FunctionDecl(std::string n, std::vector<std::string> p, Node *b) :
-  name(n), params(p), body(b) {}
+FunctionDecl::FunctionDecl(Symbol n, ArrayRef<Symbol> p, Node *b) :
+  Node(FunctionDeclKind), name(n), params(p), body(b), slots(0) {}
 
-FunctionList::FunctionList(std::vector<Node *> fs) : functions(fs) {}
+FunctionList::FunctionList(ArrayRef<Node *> fs) : Node(FunctionListKind), functions(fs) {}
 
-StatementList::StatementList(std::vector<Node *> ss) : statements(ss) {}
+StatementList::StatementList(ArrayRef<Node *> ss) : Node(StatementListKind), statements(ss) {}
 
-Program::Program(Node *fs, Node *b) : functions(fs), body(b) {}
+Program::Program(Node *fs, Node *b) :
+  Node(ProgramKind), functions(fs), body(b), slots(0) {}
 
 }
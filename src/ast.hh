@@ -3,16 +3,51 @@
 #include <string>
 #include <vector>
 
+#include "llvm/ADT/ArrayRef.h"
 #include "llvm/IR/Value.h"
+#include "llvm/Support/Casting.h"
+#include "llvm/Support/ErrorHandling.h"
 
-#include "Compiler.hh"
+#include "compiler.hh"
+#include "symbol.hh"
 
 namespace AST {
 
+enum Kind : uint8_t {
+  LiteralKind,
+  BooleanLiteralKind,
+  VariableKind,
+  BinaryOpKind,
+  UnaryOpKind,
+  DerefKind,
+  AssignKind,
+  WhileLoopKind,
+  IfKind,
+  CallKind,
+  ReturnKind,
+  FunctionDeclKind,
+  FunctionListKind,
+  StatementListKind,
+  ProgramKind
+};
+
+// Nodes live in the Arena of the parser that built them. Child and parameter
+// lists are views into that parser's arena, so they stay valid exactly as
+// long as the parser does. Names are interned Symbols.
+//
+// Each node records its kind, which llvm::isa, cast and dyn_cast test
+// through the classof of each node type, and which Visitor switches on.
+// Nodes have no virtual functions, so the compiler builds without RTTI.
 struct Node {
-  virtual llvm::Value *compile(Compiler::State &s) = 0;
+  const Kind kind;
 
-  virtual ~Node() {};
+  // Set by the Sharer on expressions that stand in for identical ones
+  // elsewhere, whose value codegen can then compute once.
+  bool shared;
+
+  Node(Kind k) : kind(k), shared(false) {}
+
+  llvm::Value *compile(Compiler::State &s);
 };
 
 struct Literal : public Node {
@@ -20,7 +55,7 @@ struct Literal : public Node {
 
   Literal(int32_t v);
   
-  llvm::Value *compile(Compiler::State &s) override;
+  static bool classof(const Node *n) { return n->kind == LiteralKind; }
 };
 
 struct BooleanLiteral : public Node {
@@ -28,15 +63,20 @@ struct BooleanLiteral : public Node {
 
   BooleanLiteral(bool v);
 
-  llvm::Value *compile(Compiler::State &s) override;
+  static bool classof(const Node *n) { return n->kind == BooleanLiteralKind; }
 };
 
 struct Variable : public Node {
-  std::string name;
+  static constexpr uint32_t unresolved = UINT32_MAX;
+
+  Symbol name;
 
-  Variable(std::string n);
+  // Index into the frame of the enclosing function, set by the Resolver.
+  uint32_t slot;
 
-  llvm::Value *compile(Compiler::State &s) override;
+  Variable(Symbol n);
+
+  static bool classof(const Node *n) { return n->kind == VariableKind; }
 };
 
 enum BinaryOpType {
@@ -68,7 +108,7 @@ struct BinaryOp : public Node {
 
   BinaryOp(Node *l, BinaryOpType t, Node *r);
 
-  llvm::Value *compile(Compiler::State &s) override;
+  static bool classof(const Node *n) { return n->kind == BinaryOpKind; }
 };
 
 struct UnaryOp : public Node {
@@ -77,7 +117,7 @@ struct UnaryOp : public Node {
 
   UnaryOp(UnaryOpType t, Node *op);
 
-  llvm::Value *compile(Compiler::State &s) override;
+  static bool classof(const Node *n) { return n->kind == UnaryOpKind; }
 };
 
 struct Deref : public Node {
@@ -85,7 +125,7 @@ struct Deref : public Node {
 
   Deref(Node *a);
 
-  llvm::Value *compile(Compiler::State &s) override;
+  static bool classof(const Node *n) { return n->kind == DerefKind; }
 };
 
 struct Assign : public Node {
@@ -94,7 +134,7 @@ struct Assign : public Node {
 
   Assign(Node *l, Node *v);
 
-  llvm::Value *compile(Compiler::State &s) override;
+  static bool classof(const Node *n) { return n->kind == AssignKind; }
 };
 
 struct WhileLoop : public Node {
@@ -103,7 +143,7 @@ struct WhileLoop : public Node {
 
   WhileLoop(Node *c, Node *b);
 
-  llvm::Value *compile(Compiler::State &s) override;
+  static bool classof(const Node *n) { return n->kind == WhileLoopKind; }
 };
 
 struct If : public Node {
@@ -114,16 +154,16 @@ struct If : public Node {
   If(Node *c, Node *t);
   If(Node *c, Node *t, Node *f);
 
-  llvm::Value *compile(Compiler::State &s) override;
+  static bool classof(const Node *n) { return n->kind == IfKind; }
 };
 
 struct Call : public Node {
-  std::string name;
-  std::vector<Node *> args;
+  Symbol name;
+  llvm::ArrayRef<Node *> args;
 
-  Call(std::string n, std::vector<Node *> a);
+  Call(Symbol n, llvm::ArrayRef<Node *> a);
 
-  llvm::Value *compile(Compiler::State &s) override;
+  static bool classof(const Node *n) { return n->kind == CallKind; }
 };
 
 struct Return : public Node {
@@ -131,42 +171,78 @@ struct Return : public Node {
 
   Return(Node *v);
 
-  llvm::Value *compile(Compiler::State &s) override;
+  static bool classof(const Node *n) { return n->kind == ReturnKind; }
 };
 
 struct FunctionDecl : public Node {
-  std::string name;
-  std::vector<std::string> params;
+  Symbol name;
+  llvm::ArrayRef<Symbol> params;
   Node *body;
 
-  FunctionDecl(std::string n, std::vector<std::string> p, Node *b);
+  // Frame size, parameters included, set by the Resolver.
+  uint32_t slots;
+
+  FunctionDecl(Symbol n, llvm::ArrayRef<Symbol> p, Node *b);
 
-  llvm::Value *compile(Compiler::State &s) override;
+  static bool classof(const Node *n) { return n->kind == FunctionDeclKind; }
 };
 
 struct FunctionList : public Node {
-  std::vector<Node *> functions;
+  llvm::ArrayRef<Node *> functions;
 
-  FunctionList(std::vector<Node *> fs);
+  FunctionList(llvm::ArrayRef<Node *> fs);
 
-  llvm::Value *compile(Compiler::State &s) override;
+  static bool classof(const Node *n) { return n->kind == FunctionListKind; }
 };
 
 struct StatementList : public Node {
-  std::vector<Node *> statements;
+  llvm::ArrayRef<Node *> statements;
 
-  StatementList(std::vector<Node *> ss);
+  StatementList(llvm::ArrayRef<Node *> ss);
 
-  llvm::Value *compile(Compiler::State &s) override;
+  static bool classof(const Node *n) { return n->kind == StatementListKind; }
 };
 
 struct Program : public Node {
   Node *functions;
   Node *body;
 
+  // Frame size of the top level statements, set by the Resolver.
+  uint32_t slots;
+
   Program(Node *fs, Node *b);
 
-  llvm::Value *compile(Compiler::State &s) override;
+  static bool classof(const Node *n) { return n->kind == ProgramKind; }
+};
+
+// Dispatches on a node's kind to Derived::visitLiteral and so on, each of
+// which takes the node as its own type. Passes derive from this rather than
+// adding virtual functions to Node.
+template<typename Derived, typename R = void>
+struct Visitor {
+  R visit(Node *node) {
+    auto self = static_cast<Derived *>(this);
+
+    switch(node->kind) {
+      case LiteralKind: return self->visitLiteral(llvm::cast<Literal>(node));
+      case BooleanLiteralKind: return self->visitBooleanLiteral(llvm::cast<BooleanLiteral>(node));
+      case VariableKind: return self->visitVariable(llvm::cast<Variable>(node));
+      case BinaryOpKind: return self->visitBinaryOp(llvm::cast<BinaryOp>(node));
+      case UnaryOpKind: return self->visitUnaryOp(llvm::cast<UnaryOp>(node));
+      case DerefKind: return self->visitDeref(llvm::cast<Deref>(node));
+      case AssignKind: return self->visitAssign(llvm::cast<Assign>(node));
+      case WhileLoopKind: return self->visitWhileLoop(llvm::cast<WhileLoop>(node));
+      case IfKind: return self->visitIf(llvm::cast<If>(node));
+      case CallKind: return self->visitCall(llvm::cast<Call>(node));
+      case ReturnKind: return self->visitReturn(llvm::cast<Return>(node));
+      case FunctionDeclKind: return self->visitFunctionDecl(llvm::cast<FunctionDecl>(node));
+      case FunctionListKind: return self->visitFunctionList(llvm::cast<FunctionList>(node));
+      case StatementListKind: return self->visitStatementList(llvm::cast<StatementList>(node));
+      case ProgramKind: return self->visitProgram(llvm::cast<Program>(node));
+    }
+
+    llvm_unreachable("unknown node kind");
+  }
 };
 
 }
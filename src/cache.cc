@@ -0,0 +1,428 @@
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <initializer_list>
+#include <vector>
+
+#include <unistd.h>
+
+#include "llvm/Support/xxhash.h"
+
+#include "cache.hh"
+#include "source.hh"
+#include "stack.hh"
+
+namespace AST {
+
+namespace {
+
+const char magic[4] = { 'P', 'B', 'A', 'S' };
+
+struct Header {
+  char magic[4];
+  uint32_t version;
+  uint64_t sourceHash;
+  uint64_t sourceSize;
+  uint32_t nodes;
+  uint32_t links;
+  uint32_t decls;
+  uint32_t params;
+  uint32_t names;
+  uint32_t nameBytes;
+};
+
+static_assert(sizeof(Kind) == 1, "kinds are stored a byte each");
+static_assert(sizeof(FlatTree::Decl) == 12, "decls are stored unpadded");
+
+// Byte offset of each array in the image, which follow the header in this
+// order. Names are stored as one run of characters and the end offset of
+// each. Every array starts on a four byte boundary, so the mapped arrays can
+// be read in place.
+struct Layout {
+  size_t kinds;
+  size_t payloads;
+  size_t firstLink;
+  size_t links;
+  size_t decls;
+  size_t params;
+  size_t nameEnds;
+  size_t nameChars;
+  size_t size;
+
+  Layout(const Header &h) {
+    size_t at = sizeof(Header);
+    kinds = take(at, h.nodes);
+    payloads = take(at, 4 * size_t(h.nodes));
+    firstLink = take(at, 4 * (size_t(h.nodes) + 1));
+    links = take(at, 4 * size_t(h.links));
+    decls = take(at, sizeof(FlatTree::Decl) * h.decls);
+    params = take(at, 4 * size_t(h.params));
+    nameEnds = take(at, 4 * size_t(h.names));
+    nameChars = take(at, h.nameBytes);
+    size = at;
+  }
+
+  static size_t take(size_t &at, size_t bytes) {
+    size_t start = at;
+    at = (at + bytes + 3) & ~size_t(3);
+    return start;
+  }
+};
+
+// Rebuilds the nodes of an image. Nodes have to come in exactly the preorder
+// FlatTree numbers them in, which also rules out cycles and shared subtrees
+// in a damaged image, and every index is checked before it's followed.
+struct Loader {
+  const Header &h;
+  const Kind *kinds;
+  const uint32_t *payloads;
+  const uint32_t *firstLink;
+  const uint32_t *links;
+  const FlatTree::Decl *decls;
+  const uint32_t *params;
+  std::vector<Symbol> names;
+
+  Arena &arena;
+  uint32_t next;
+  bool failed;
+
+  Loader(const Header &h, const char *image, Arena &a);
+
+  Node *build();
+  Node *child(uint32_t node, size_t i, bool optional = false);
+  Node *child(uint32_t node, size_t i, std::initializer_list<Kind> allowed, bool optional = false);
+  llvm::ArrayRef<Node *> list(uint32_t node, size_t count, std::initializer_list<Kind> allowed = {});
+
+  Node *fail();
+};
+
+Loader::Loader(const Header &h, const char *image, Arena &a) :
+  h(h), arena(a), next(0), failed(false)
+{
+  Layout l(h);
+  kinds = reinterpret_cast<const Kind *>(image + l.kinds);
+  payloads = reinterpret_cast<const uint32_t *>(image + l.payloads);
+  firstLink = reinterpret_cast<const uint32_t *>(image + l.firstLink);
+  links = reinterpret_cast<const uint32_t *>(image + l.links);
+  decls = reinterpret_cast<const FlatTree::Decl *>(image + l.decls);
+  params = reinterpret_cast<const uint32_t *>(image + l.params);
+
+  auto ends = reinterpret_cast<const uint32_t *>(image + l.nameEnds);
+  auto chars = image + l.nameChars;
+
+  uint32_t begin = 0;
+  for(uint32_t i = 0; i < h.names; ++i) {
+    if(ends[i] < begin || ends[i] > h.nameBytes) {
+      failed = true;
+      return;
+    }
+
+    names.push_back(Symbol::intern(std::string_view(chars + begin, ends[i] - begin)));
+    begin = ends[i];
+  }
+
+  if(h.nodes == 0 || firstLink[0] != 0 || firstLink[h.nodes] != h.links) {
+    failed = true;
+    return;
+  }
+
+  for(uint32_t i = 0; i < h.nodes; ++i) {
+    if(firstLink[i + 1] < firstLink[i]) {
+      failed = true;
+      return;
+    }
+  }
+}
+
+Node *Loader::fail() {
+  failed = true;
+  return nullptr;
+}
+
+Node *Loader::child(uint32_t node, size_t i, bool optional) {
+  auto index = links[firstLink[node] + i];
+  if(index == FlatTree::none) {
+    return optional ? nullptr : fail();
+  }
+
+  return index == next ? build() : fail();
+}
+
+// Later passes cast children to the kinds the parser gives them, such as
+// assigning only to variables and dereferences, so a child of any other kind
+// rejects the image. An empty list allows any kind.
+Node *Loader::child(uint32_t node, size_t i, std::initializer_list<Kind> allowed, bool optional) {
+  auto index = links[firstLink[node] + i];
+  if(allowed.size() > 0 && index != FlatTree::none && index < h.nodes &&
+     std::find(allowed.begin(), allowed.end(), kinds[index]) == allowed.end()) {
+    return fail();
+  }
+
+  return child(node, i, optional);
+}
+
+llvm::ArrayRef<Node *> Loader::list(uint32_t node, size_t count, std::initializer_list<Kind> allowed) {
+  if(count == 0) {
+    return {};
+  }
+
+  auto items = static_cast<Node **>(arena.allocate(sizeof(Node *) * count, alignof(Node *)));
+  for(size_t i = 0; i < count; ++i) {
+    items[i] = child(node, i, allowed);
+  }
+  return { items, count };
+}
+
+// Children are built into locals first, so that they're read in order.
+Node *Loader::build() {
+  if(Stack::low()) {
+    return Stack::fresh([&] { return build(); });
+  }
+
+  if(failed || next >= h.nodes) {
+    return fail();
+  }
+
+  auto node = next++;
+  auto payload = payloads[node];
+  auto arity = firstLink[node + 1] - firstLink[node];
+
+  switch(kinds[node]) {
+    case LiteralKind:
+      if(arity == 0) {
+        return arena.make<Literal>(static_cast<int32_t>(payload));
+      }
+      break;
+
+    case BooleanLiteralKind:
+      if(arity == 0 && payload <= 1) {
+        return arena.make<BooleanLiteral>(payload != 0);
+      }
+      break;
+
+    case VariableKind:
+      if(arity == 0 && payload < names.size()) {
+        return arena.make<Variable>(names[payload]);
+      }
+      break;
+
+    case BinaryOpKind:
+      if(arity == 2 && payload < Invalid) {
+        auto left = child(node, 0);
+        auto right = child(node, 1);
+        return arena.make<BinaryOp>(left, static_cast<BinaryOpType>(payload), right);
+      }
+      break;
+
+    case UnaryOpKind:
+      if(arity == 1 && payload < UnaryInvalid) {
+        auto operand = child(node, 0);
+        return arena.make<UnaryOp>(static_cast<UnaryOpType>(payload), operand);
+      }
+      break;
+
+    case DerefKind:
+      if(arity == 1) {
+        return arena.make<Deref>(child(node, 0));
+      }
+      break;
+
+    case AssignKind:
+      if(arity == 2) {
+        auto location = child(node, 0, { VariableKind, DerefKind });
+        auto value = child(node, 1);
+        return arena.make<Assign>(location, value);
+      }
+      break;
+
+    case WhileLoopKind:
+      if(arity == 2) {
+        auto condition = child(node, 0);
+        auto body = child(node, 1, { StatementListKind });
+        return arena.make<WhileLoop>(condition, body);
+      }
+      break;
+
+    case IfKind:
+      if(arity == 3) {
+        auto condition = child(node, 0);
+        auto trueBody = child(node, 1, { StatementListKind });
+        auto falseBody = child(node, 2, { StatementListKind }, true);
+        return arena.make<If>(condition, trueBody, falseBody);
+      }
+      break;
+
+    case CallKind:
+      if(payload < names.size()) {
+        return arena.make<Call>(names[payload], list(node, arity));
+      }
+      break;
+
+    case ReturnKind:
+      if(arity == 1) {
+        return arena.make<Return>(child(node, 0, true));
+      }
+      break;
+
+    case FunctionDeclKind: {
+      if(arity != 1 || payload >= h.decls) {
+        break;
+      }
+
+      auto &decl = decls[payload];
+      if(decl.name >= names.size() ||
+         uint64_t(decl.firstParam) + decl.paramCount > h.params) {
+        break;
+      }
+
+      llvm::ArrayRef<Symbol> declParams;
+      if(decl.paramCount > 0) {
+        auto ps = static_cast<Symbol *>(arena.allocate(sizeof(Symbol) * decl.paramCount, alignof(Symbol)));
+        for(uint32_t i = 0; i < decl.paramCount; ++i) {
+          auto p = params[decl.firstParam + i];
+          if(p >= names.size()) {
+            return fail();
+          }
+          ps[i] = names[p];
+        }
+        declParams = llvm::makeArrayRef(ps, decl.paramCount);
+      }
+
+      auto body = child(node, 0, { StatementListKind });
+      return arena.make<FunctionDecl>(names[decl.name], declParams, body);
+    }
+
+    case FunctionListKind:
+      return arena.make<FunctionList>(list(node, arity, { FunctionDeclKind }));
+
+    case StatementListKind:
+      return arena.make<StatementList>(list(node, arity));
+
+    case ProgramKind:
+      if(arity == 2) {
+        auto functions = child(node, 0);
+        auto body = child(node, 1);
+        if(failed || !llvm::isa<FunctionList>(functions) || !llvm::isa<StatementList>(body)) {
+          return fail();
+        }
+        return arena.make<Program>(functions, body);
+      }
+      break;
+  }
+
+  return fail();
+}
+
+}
+
+CachedProgram::CachedProgram() :
+  root(nullptr)
+{
+}
+
+CachedProgram::Key CachedProgram::Key::of(std::string_view source) {
+  return { llvm::xxHash64(llvm::StringRef(source.data(), source.size())), source.size() };
+}
+
+std::string CachedProgram::path(const std::string &dir, const std::string &file, Key key) {
+  if(dir.empty()) {
+    return file + ".ast";
+  }
+
+  char name[32];
+  std::snprintf(name, sizeof(name), "%016" PRIx64 ".ast", key.hash);
+  return dir + "/" + name;
+}
+
+bool CachedProgram::store(const std::string &path, Key key, const FlatTree &tree) {
+  std::string chars;
+  std::vector<uint32_t> nameEnds;
+  for(auto name : tree.names) {
+    auto text = name.str();
+    chars.append(text.data(), text.size());
+    nameEnds.push_back(chars.size());
+  }
+
+  Header h = {};
+  std::memcpy(h.magic, magic, sizeof(magic));
+  h.version = version;
+  h.sourceHash = key.hash;
+  h.sourceSize = key.size;
+  h.nodes = tree.kinds.size();
+  h.links = tree.links.size();
+  h.decls = tree.decls.size();
+  h.params = tree.params.size();
+  h.names = nameEnds.size();
+  h.nameBytes = chars.size();
+
+  Layout l(h);
+  std::string image(l.size, '\0');
+  auto put = [&](size_t at, const void *data, size_t bytes) {
+    if(bytes > 0) {
+      std::memcpy(&image[at], data, bytes);
+    }
+  };
+
+  put(0, &h, sizeof(h));
+  put(l.kinds, tree.kinds.data(), tree.kinds.size());
+  put(l.payloads, tree.payloads.data(), 4 * tree.payloads.size());
+  put(l.firstLink, tree.firstLink.data(), 4 * tree.firstLink.size());
+  put(l.links, tree.links.data(), 4 * tree.links.size());
+  put(l.decls, tree.decls.data(), sizeof(FlatTree::Decl) * tree.decls.size());
+  put(l.params, tree.params.data(), 4 * tree.params.size());
+  put(l.nameEnds, nameEnds.data(), 4 * nameEnds.size());
+  put(l.nameChars, chars.data(), chars.size());
+
+  auto temp = path + "." + std::to_string(getpid()) + ".tmp";
+  std::ofstream out(temp, std::ios::binary);
+  out.write(image.data(), image.size());
+  out.close();
+
+  if(!out || std::rename(temp.c_str(), path.c_str()) != 0) {
+    std::remove(temp.c_str());
+    return false;
+  }
+
+  return true;
+}
+
+std::unique_ptr<CachedProgram> CachedProgram::load(const std::string &path, Key key) {
+  // The image is only read while the nodes are rebuilt, and nothing refers
+  // to it afterwards.
+  auto image = SourceFile::open(path);
+  if(!image) {
+    return nullptr;
+  }
+
+  auto bytes = image->text();
+  Header h;
+  if(bytes.size() < sizeof(h)) {
+    return nullptr;
+  }
+  std::memcpy(&h, bytes.data(), sizeof(h));
+
+  if(std::memcmp(h.magic, magic, sizeof(magic)) != 0 || h.version != version ||
+     h.sourceHash != key.hash || h.sourceSize != key.size ||
+     Layout(h).size != bytes.size()) {
+    return nullptr;
+  }
+
+  std::unique_ptr<CachedProgram> cached(new CachedProgram());
+  Loader loader(h, bytes.data(), cached->arena);
+  auto root = loader.failed ? nullptr : loader.build();
+
+  if(loader.failed || loader.next != h.nodes || !llvm::isa<Program>(root)) {
+    return nullptr;
+  }
+
+  cached->root = llvm::cast<Program>(root);
+  return cached;
+}
+
+Program *CachedProgram::program() const {
+  return root;
+}
+
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "arena.hh"
+#include "ast.hh"
+#include "flat.hh"
+
+namespace AST {
+
+// A parsed program saved to disk as the arrays of its FlatTree, so that an
+// unchanged source can skip lexing and parsing. The image is versioned and
+// records the hash and size of the source it came from; loading maps it,
+// checks it against the source, and rebuilds the nodes in one pass into a
+// single arena, reading the arrays in place. Names are interned once each.
+struct CachedProgram {
+  // Bumped whenever the image layout or the meaning of a payload changes.
+  static constexpr uint32_t version = 1;
+
+  // Identifies the source an image was made from.
+  struct Key {
+    uint64_t hash;
+    uint64_t size;
+
+    static Key of(std::string_view source);
+  };
+
+  // Where the image for a source goes: <dir>/<hash>.ast, or next to the
+  // source file if no directory is given.
+  static std::string path(const std::string &dir, const std::string &file, Key key);
+
+  // Writes the image atomically, so concurrent readers see either the old
+  // image or the complete new one.
+  static bool store(const std::string &path, Key key, const FlatTree &tree);
+
+  // Null if there's no image, or it's stale, from another version or damaged.
+  static std::unique_ptr<CachedProgram> load(const std::string &path, Key key);
+
+  Program *program() const;
+
+private:
+  Arena arena;
+  Program *root;
+
+  CachedProgram();
+};
+
+}
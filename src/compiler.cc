@@ -3,77 +3,146 @@
 #include <llvm/IR/Constants.h>
 #include <llvm/IR/BasicBlock.h>
 #include <llvm/IR/Function.h>
+#include <llvm/IR/Metadata.h>
 
 #include "compiler.hh"
 #include "ast.hh"
+#include "stack.hh"
 
 using namespace llvm;
 using namespace AST;
 using namespace Compiler;
 
-State::State() : B(C) {
+State::State() : context(new LLVMContext), C(*context), B(C) {
   intTy = IntegerType::get(C, 32);
   Mod = std::unique_ptr<Module>(new Module("main-mod", C));  
 
   Type *memTy = ArrayType::get(intTy, 1024);
-  memory = new GlobalVariable(*Mod, memTy, false, GlobalValue::CommonLinkage, 0, "memory");
+  memory = new GlobalVariable(*Mod, memTy, false, GlobalValue::CommonLinkage, ConstantAggregateZero::get(memTy), "memory");
 }
 
-Value *State::lookupSymbol(std::string name) {
-  for(auto it = symbols.rbegin(); it != symbols.rend(); it++) {
-    auto map = *it;
-    if(map.find(name) != map.end()) {
-      return map[name];
-    }
+Value *State::slot(uint32_t index) {
+  if(index >= frame.size()) {
+    frame.resize(index + 1, nullptr);
   }
 
-  return nullptr;
+  if(frame[index] == nullptr) {
+    auto &entry = B.GetInsertBlock()->getParent()->getEntryBlock();
+    IRBuilder<> top(&entry, entry.begin());
+    frame[index] = top.CreateAlloca(intTy);
+  }
+
+  return frame[index];
+}
+
+void State::beginMain() {
+  frame.clear();
+
+  Type *retTy = IntegerType::get(C, 32);
+  Type *argcTy = IntegerType::get(C, 32);
+  Type *argvTy = PointerType::getUnqual(PointerType::getUnqual(IntegerType::get(C, 8)));
+
+  Function *f = Function::Create(
+      FunctionType::get(retTy, { argcTy, argvTy }, false),
+      GlobalValue::ExternalLinkage,
+      "main",
+      Mod.get());
+  BasicBlock *main = BasicBlock::Create(C, "entry", f);
+  B.SetInsertPoint(main);
 }
 
-void State::registerSymbol(std::string name, Value *val) {
-  if(symbols.empty()) {
+void State::finishMain() {
+  if(B.GetInsertBlock()->getTerminator() != nullptr) {
     return;
   }
 
-  symbols.back()[name] = val;
+  Value *addr = ConstantInt::get(intTy, 0);
+  Type *ptrTy = PointerType::getUnqual(intTy);
+  Value *ptr = B.CreateBitCast(memory, ptrTy);
+  Value *offset = B.CreateGEP(intTy, ptr, addr);
+  Value *loaded = B.CreateLoad(intTy, offset);
+  B.CreateRet(loaded);
 }
 
-void State::pushContext() {
-  symbols.push_back(std::map<std::string, Value*>());
-}
+// Emits IR for each kind of node into the state's module.
+struct Codegen : public Visitor<Codegen, Value *> {
+  State &s;
 
-void State::popContext() {
-  symbols.pop_back();
-}
+  // Values of shared nodes already emitted in the current function. The
+  // Sharer only shares a node within a straight-line region, over which
+  // nothing it reads can change, so one value serves every use.
+  DenseMap<Node *, Value *> values;
 
-bool State::hasSymbol(std::string name) {
-  for(auto it = symbols.rbegin(); it != symbols.rend(); it++) {
-    auto map = *it;
-    if(map.find(name) != map.end()) {
-      return true;
+  Codegen(State &s) : s(s) {}
+
+  Value *visit(Node *node) {
+    if(!node->shared) {
+      return Visitor::visit(node);
     }
+
+    if(auto v = values.lookup(node)) {
+      return v;
+    }
+
+    auto v = Visitor::visit(node);
+    values[node] = v;
+    return v;
   }
 
-  return false;
+  Value *visitLiteral(Literal *node);
+  Value *visitBooleanLiteral(BooleanLiteral *node);
+  Value *visitVariable(Variable *node);
+  Value *visitBinaryOp(BinaryOp *node);
+  Value *visitUnaryOp(UnaryOp *node);
+  Value *visitDeref(Deref *node);
+  Value *visitAssign(Assign *node);
+  Value *visitWhileLoop(WhileLoop *node);
+  Value *visitIf(If *node);
+  Value *visitCall(Call *node);
+  Value *visitReturn(Return *node);
+  Value *visitFunctionDecl(FunctionDecl *node);
+  Value *visitFunctionList(FunctionList *node);
+  Value *visitStatementList(StatementList *node);
+  Value *visitProgram(Program *node);
+
+  // Whether the block being filled already ends, after a return.
+  bool terminated();
+
+  // Moves on to a new block. Shared values from other blocks might not
+  // dominate it, so they're forgotten.
+  void enter(BasicBlock *block);
+
+  void branch(BasicBlock *to);
+
+  // Declared by the first call or definition, whichever comes first.
+  Function *function(Symbol name, size_t params);
+};
+
+Value *Node::compile(State &s) {
+  return Codegen(s).visit(this);
 }
 
-Value *Literal::compile(State &s) {
-  return ConstantInt::getSigned(s.intTy, value);
+Value *Codegen::visitLiteral(Literal *node) {
+  return ConstantInt::getSigned(s.intTy, node->value);
 }
 
-Value *BooleanLiteral::compile(State &s) {
-  return value ? ConstantInt::getTrue(s.intTy) : ConstantInt::getFalse(s.intTy);
+Value *Codegen::visitBooleanLiteral(BooleanLiteral *node) {
+  return node->value ? ConstantInt::getTrue(s.C) : ConstantInt::getFalse(s.C);
 }
 
-Value *Variable::compile(State &s) {
-  return s.lookupSymbol(name);
+Value *Codegen::visitVariable(Variable *node) {
+  return s.B.CreateLoad(s.intTy, s.slot(node->slot));
 }
 
-Value *BinaryOp::compile(State &s) {
-  Value *lhs = left->compile(s);
-  Value *rhs = right->compile(s);
+Value *Codegen::visitBinaryOp(BinaryOp *node) {
+  if(Stack::low()) {
+    return Stack::fresh([&] { return visitBinaryOp(node); });
+  }
+
+  Value *lhs = visit(node->left);
+  Value *rhs = visit(node->right);
 
-  switch(type) {
+  switch(node->type) {
     case Add:
       return s.B.CreateAdd(lhs, rhs);
     case Subtract:
@@ -105,10 +174,14 @@ Value *BinaryOp::compile(State &s) {
   }
 }
 
-Value *UnaryOp::compile(State &s) {
-  Value *v = operand->compile(s);
+Value *Codegen::visitUnaryOp(UnaryOp *node) {
+  if(Stack::low()) {
+    return Stack::fresh([&] { return visitUnaryOp(node); });
+  }
+
+  Value *v = visit(node->operand);
 
-  switch(type) {
+  switch(node->type) {
     case Not:
       return s.B.CreateNot(v);
     default:
@@ -116,132 +189,193 @@ Value *UnaryOp::compile(State &s) {
   }
 }
 
-Value *Deref::compile(State &s) {
-  Value *addr = address->compile(s);
+Value *Codegen::visitDeref(Deref *node) {
+  if(Stack::low()) {
+    return Stack::fresh([&] { return visitDeref(node); });
+  }
+
+  Value *addr = visit(node->address);
   Type *ptrTy = PointerType::getUnqual(s.intTy);
   Value *ptr = s.B.CreateBitCast(s.memory, ptrTy);
-  Value *offset = s.B.CreateGEP(ptr, addr);
-  return s.B.CreateLoad(offset);
+  Value *offset = s.B.CreateGEP(s.intTy, ptr, addr);
+  return s.B.CreateLoad(s.intTy, offset);
 }
 
-Value *Assign::compile(State &s) {
-  auto deref = dynamic_cast<Deref *>(location);
-  Value *loc;
-  if(deref) {
-    Value *offset = deref->address->compile(s);
+Value *Codegen::visitAssign(Assign *node) {
+  Value *loc = nullptr;
+
+  if(auto deref = dyn_cast<Deref>(node->location)) {
+    Value *offset = visit(deref->address);
     Type *ptrTy = PointerType::getUnqual(s.intTy);
     Value *ptr = s.B.CreateBitCast(s.memory, ptrTy);
-    loc = s.B.CreateGEP(ptr, offset);
+    loc = s.B.CreateGEP(s.intTy, ptr, offset);
+  } else if(auto var = dyn_cast<Variable>(node->location)) {
+    loc = s.slot(var->slot);
   }
 
-  auto var = dynamic_cast<Variable *>(location);
-  if(var) {
-    if(!s.hasSymbol(var->name)) {
-      s.registerSymbol(var->name, s.B.CreateAlloca(s.intTy));
-    }
-    loc = s.lookupSymbol(var->name);
+  auto val = visit(node->value);
+  return s.B.CreateStore(val, loc);
+}
+
+bool Codegen::terminated() {
+  return s.B.GetInsertBlock()->getTerminator() != nullptr;
+}
+
+void Codegen::enter(BasicBlock *block) {
+  s.B.SetInsertPoint(block);
+  values.clear();
+}
+
+void Codegen::branch(BasicBlock *to) {
+  if(!terminated()) {
+    s.B.CreateBr(to);
   }
+}
 
-  auto val = value->compile(s);
-  return s.B.CreateStore(val, loc);
+Function *Codegen::function(Symbol name, size_t params) {
+  if(auto f = s.Mod->getFunction(name.str())) {
+    return f;
+  }
+
+  std::vector<Type *> paramTypes(params, s.intTy);
+  FunctionType *funcTy = FunctionType::get(s.intTy, paramTypes, false);
+  return Function::Create(funcTy, GlobalValue::ExternalLinkage, name.str(), s.Mod.get());
 }
 
-Value *WhileLoop::compile(State &s) {
+// Loops are emitted rotated, in the form LLVM's loop passes expect, so that
+// the test runs once before the loop and then at the bottom of each pass:
+//
+//   guard:     br cond, preheader, end
+//   preheader: br body
+//   body:      ...; br latch
+//   latch:     br cond, body, exit    ; !llvm.loop
+//   exit:      br end
+//
+// The latch carries the loop's llvm.loop ID, which the vectorizer and
+// unroller use to find hints and to record what they've done to it.
+Value *Codegen::visitWhileLoop(WhileLoop *node) {
+  auto f = s.B.GetInsertBlock()->getParent();
+  auto preheader = BasicBlock::Create(s.C, "while.preheader", f);
+  auto body = BasicBlock::Create(s.C, "while.body", f);
+  auto latch = BasicBlock::Create(s.C, "while.latch", f);
+  auto exit = BasicBlock::Create(s.C, "while.exit", f);
+  auto end = BasicBlock::Create(s.C, "while.end", f);
+
+  s.B.CreateCondBr(visit(node->condition), preheader, end);
+
+  enter(preheader);
+  s.B.CreateBr(body);
+
+  enter(body);
+  visit(node->body);
+  branch(latch);
+
+  enter(latch);
+  auto back = s.B.CreateCondBr(visit(node->condition), body, exit);
+
+  auto id = MDNode::getDistinct(s.C, { nullptr });
+  id->replaceOperandWith(0, id);
+  back->setMetadata(LLVMContext::MD_loop, id);
+
+  enter(exit);
+  s.B.CreateBr(end);
+
+  enter(end);
   return nullptr;
 }
 
-Value *If::compile(State &s) {
+Value *Codegen::visitIf(If *node) {
+  auto f = s.B.GetInsertBlock()->getParent();
+  auto then = BasicBlock::Create(s.C, "if.then", f);
+  auto otherwise = node->falseBody ? BasicBlock::Create(s.C, "if.else", f) : nullptr;
+  auto end = BasicBlock::Create(s.C, "if.end", f);
+
+  s.B.CreateCondBr(visit(node->condition), then, otherwise ? otherwise : end);
+
+  enter(then);
+  visit(node->trueBody);
+  branch(end);
+
+  if(otherwise) {
+    enter(otherwise);
+    visit(node->falseBody);
+    branch(end);
+  }
+
+  enter(end);
   return nullptr;
 }
 
-Value *Call::compile(State &s) {
+Value *Codegen::visitCall(Call *node) {
   std::vector<Value *> argVals;
 
-  for(auto arg : args) {
-    argVals.push_back(arg->compile(s));
+  for(auto arg : node->args) {
+    argVals.push_back(visit(arg));
   }
 
-  Function *f = s.Mod->getFunction(name);
+  Function *f = function(node->name, node->args.size());
 
   return s.B.CreateCall(f, argVals);
 }
 
-Value *FunctionDecl::compile(State &s) {
-  Type *retTy = s.intTy;
-  std::vector<Type *> paramTypes;
-  for(auto p : params) {
-    paramTypes.push_back(s.intTy);
-  }
+// Falling off the end of a function returns 0.
+Value *Codegen::visitFunctionDecl(FunctionDecl *node) {
+  Function *f = function(node->name, node->params.size());
 
-  FunctionType *funcTy = FunctionType::get(retTy, paramTypes, false);
-  Function *f = Function::Create(funcTy, GlobalValue::ExternalLinkage, name, s.Mod.get());
-
-  s.pushContext();
+  BasicBlock *entry = BasicBlock::Create(s.C, "entry", f);
+  s.B.SetInsertPoint(entry);
 
-  int i = 0;
-  for(auto it = f->arg_begin(); it != f->arg_end(); it++, i++) {
-    s.registerSymbol(params[i], &(*it));
+  s.frame.assign(node->slots, nullptr);
+  values.clear();
+  for(auto &arg : f->args()) {
+    s.B.CreateStore(&arg, s.slot(arg.getArgNo()));
   }
 
-  BasicBlock *entry = BasicBlock::Create(s.C, "entry", f);
-  s.B.SetInsertPoint(entry);
-  Value *last = body->compile(s);
+  visit(node->body);
 
-  s.popContext();
-  
-  if(isa<ReturnInst>(last)) {
-    return last;
+  if(!terminated()) {
+    s.B.CreateRet(ConstantInt::get(s.intTy, 0));
   }
 
-  return s.B.CreateRetVoid();
+  return f;
 }
 
-Value *Return::compile(State &s) {
-  return s.B.CreateRet(value->compile(s));
+Value *Codegen::visitReturn(Return *node) {
+  Value *v = node->value ? visit(node->value) : ConstantInt::get(s.intTy, 0);
+  return s.B.CreateRet(v);
 }
 
-Value *FunctionList::compile(State &s) {
-  for(auto func : functions) {
-    func->compile(s);
+Value *Codegen::visitFunctionList(FunctionList *node) {
+  for(auto func : node->functions) {
+    visit(func);
   }
 
   return nullptr;
 }
 
-Value *StatementList::compile(State &s) {
+Value *Codegen::visitStatementList(StatementList *node) {
+  if(Stack::low()) {
+    return Stack::fresh([&] { return visitStatementList(node); });
+  }
+
+  // Nothing after a return can run, and a block can't go on past it.
   Value *last = nullptr;
-  for(auto stmt : statements) {
-    last = stmt->compile(s);
+  for(auto stmt : node->statements) {
+    if(terminated()) {
+      break;
+    }
+    last = visit(stmt);
   }
 
   return last;
 }
 
-Value *Program::compile(State &s) {
-  functions->compile(s);
-
-  s.pushContext();
-
-  Type *retTy = IntegerType::get(s.C, 32);
-  Type *argcTy = IntegerType::get(s.C, 32);
-  Type *argvTy = PointerType::getUnqual(PointerType::getUnqual(IntegerType::get(s.C, 8)));
-
-  Function *f = Function::Create(
-      FunctionType::get(retTy, { argcTy, argvTy }, false),
-      GlobalValue::ExternalLinkage,
-      "main",
-      s.Mod.get());
-  BasicBlock *main = BasicBlock::Create(s.C, "entry", f);
-  s.B.SetInsertPoint(main);
-  body->compile(s);
-
-  Value *addr = ConstantInt::get(s.intTy, 0);
-  Type *ptrTy = PointerType::getUnqual(s.intTy);
-  Value *ptr = s.B.CreateBitCast(s.memory, ptrTy);
-  Value *offset = s.B.CreateGEP(ptr, addr);
-  Value *loaded = s.B.CreateLoad(offset);
-  s.B.CreateRet(loaded);
+Value *Codegen::visitProgram(Program *node) {
+  visit(node->functions);
 
-  s.Mod->dump();
+  s.beginMain();
+  values.clear();
+  visit(node->body);
+  s.finishMain();
   return nullptr;
 }
@@ -7,12 +7,18 @@
 #include <llvm/IR/Function.h>
 #include <llvm/IR/DerivedTypes.h>
 
+#include <memory>
+#include <vector>
+
 using namespace llvm;
 
 namespace Compiler {
 
 struct State {
-  LLVMContext C;
+  // Owned separately so that the context can be handed over along with the
+  // module, to a JIT for instance, once compiling is done.
+  std::unique_ptr<LLVMContext> context;
+  LLVMContext &C;
   std::unique_ptr<Module> Mod;
   IRBuilder<> B;
   std::vector<Function> Funcs;
@@ -20,15 +26,19 @@ struct State {
 
   Value *memory;
 
-  Value *lookupSymbol(std::string name);
-  void registerSymbol(std::string name, Value *val);
-  void pushContext();
-  void popContext();
-  bool hasSymbol(std::string name);
+  // Slots of the function being compiled, as numbered by AST::Resolver.
+  // Each is an alloca in the function's entry block, made when the slot is
+  // first used.
+  std::vector<Value *> frame;
+
+  Value *slot(uint32_t index);
+
+  // Top level statements are compiled into main, which returns memory[0]
+  // unless a top level return ended it first.
+  void beginMain();
+  void finishMain();
 
   State();
-private:
-  std::vector<std::map<std::string, Value*>> symbols;
 };
 
 }
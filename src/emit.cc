@@ -0,0 +1,241 @@
+#include "llvm/ADT/Triple.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/InlineAsm.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Program.h"
+
+#include "emit.hh"
+
+using namespace llvm;
+
+namespace Compiler {
+
+bool parseOutput(StringRef arg, Output &kind) {
+  if(arg == "obj") {
+    kind = Output::Object;
+  } else if(arg == "asm") {
+    kind = Output::Assembly;
+  } else if(arg == "bc") {
+    kind = Output::Bitcode;
+  } else if(arg == "ll") {
+    kind = Output::IR;
+  } else if(arg == "exe") {
+    kind = Output::Executable;
+  } else {
+    return false;
+  }
+
+  return true;
+}
+
+StringRef extension(Output kind) {
+  switch(kind) {
+    case Output::Object: return "o";
+    case Output::Assembly: return "s";
+    case Output::Bitcode: return "bc";
+    case Output::IR: return "ll";
+    default: return "";
+  }
+}
+
+bool emit(Module &m, TargetMachine &machine, Output kind, raw_pwrite_stream &os, std::string &error) {
+  m.setTargetTriple(machine.getTargetTriple().str());
+  m.setDataLayout(machine.createDataLayout());
+
+  switch(kind) {
+    case Output::Bitcode:
+      WriteBitcodeToFile(m, os);
+      return true;
+    case Output::IR:
+      m.print(os, nullptr);
+      return true;
+    case Output::Object:
+    case Output::Assembly: {
+      legacy::PassManager passes;
+      auto type = kind == Output::Object ? CGFT_ObjectFile : CGFT_AssemblyFile;
+      if(machine.addPassesToEmitFile(passes, os, nullptr, type)) {
+        error = "The target can't emit this kind of file";
+        return false;
+      }
+      passes.run(m);
+      return true;
+    }
+    default:
+      error = "Executables can't be written to a stream";
+      return false;
+  }
+}
+
+// Byte at a time is slow but enough for the runtime: the functions only
+// exist because optimized loops get lowered to calls to them. They're marked
+// no-builtins so that codegen doesn't turn their own loops back into calls.
+static Function *memoryFunction(Module &m, StringRef name, FunctionType *type) {
+  auto f = Function::Create(type, GlobalValue::ExternalLinkage, name, m);
+  f->addFnAttr(Attribute::NoUnwind);
+  f->addFnAttr("no-builtins");
+  return f;
+}
+
+// Copies or sets n bytes at dst, going forwards or backwards: set stores the
+// low byte of value at each address, and otherwise each byte is read from
+// src.
+static void byteLoop(IRBuilder<> &B, Value *dst, Value *src, Value *value, Value *n, bool backwards) {
+  auto &C = B.getContext();
+  auto f = B.GetInsertBlock()->getParent();
+  auto i64 = B.getInt64Ty();
+  auto entry = B.GetInsertBlock();
+  auto loop = BasicBlock::Create(C, backwards ? "backwards" : "forwards", f);
+  auto done = BasicBlock::Create(C, "done", f);
+
+  B.CreateCondBr(B.CreateICmpEQ(n, ConstantInt::get(i64, 0)), done, loop);
+
+  B.SetInsertPoint(loop);
+  auto i = B.CreatePHI(i64, 2);
+  i->addIncoming(ConstantInt::get(i64, 0), entry);
+  auto offset = backwards ? B.CreateSub(B.CreateSub(n, i), ConstantInt::get(i64, 1)) : static_cast<Value *>(i);
+  auto byte = src != nullptr ? B.CreateLoad(B.getInt8Ty(), B.CreateGEP(B.getInt8Ty(), src, offset))
+                             : B.CreateTrunc(value, B.getInt8Ty());
+  B.CreateStore(byte, B.CreateGEP(B.getInt8Ty(), dst, offset));
+  auto next = B.CreateAdd(i, ConstantInt::get(i64, 1));
+  i->addIncoming(next, loop);
+  B.CreateCondBr(B.CreateICmpEQ(next, n), done, loop);
+
+  B.SetInsertPoint(done);
+}
+
+// memset, memcpy and memmove, which codegen calls for llvm.memset and
+// friends. Nothing else is linked in, so these are the only definitions.
+static void addMemoryFunctions(Module &m) {
+  auto &C = m.getContext();
+  IRBuilder<> B(C);
+  auto ptr = B.getInt8PtrTy();
+  auto i64 = B.getInt64Ty();
+
+  auto set = memoryFunction(m, "memset", FunctionType::get(ptr, { ptr, B.getInt32Ty(), i64 }, false));
+  B.SetInsertPoint(BasicBlock::Create(C, "entry", set));
+  byteLoop(B, set->getArg(0), nullptr, set->getArg(1), set->getArg(2), false);
+  B.CreateRet(set->getArg(0));
+
+  auto copyTy = FunctionType::get(ptr, { ptr, ptr, i64 }, false);
+  auto copy = memoryFunction(m, "memcpy", copyTy);
+  B.SetInsertPoint(BasicBlock::Create(C, "entry", copy));
+  byteLoop(B, copy->getArg(0), copy->getArg(1), nullptr, copy->getArg(2), false);
+  B.CreateRet(copy->getArg(0));
+
+  // Copying backwards is safe when dst overlaps the end of src.
+  auto move = memoryFunction(m, "memmove", copyTy);
+  auto forwards = BasicBlock::Create(C, "entry.forwards", move);
+  auto backwards = BasicBlock::Create(C, "entry.backwards", move);
+
+  B.SetInsertPoint(BasicBlock::Create(C, "entry", move, forwards));
+  auto dst = B.CreatePtrToInt(move->getArg(0), i64);
+  auto src = B.CreatePtrToInt(move->getArg(1), i64);
+  B.CreateCondBr(B.CreateICmpULE(dst, src), forwards, backwards);
+
+  B.SetInsertPoint(forwards);
+  byteLoop(B, move->getArg(0), move->getArg(1), nullptr, move->getArg(2), false);
+  B.CreateRet(move->getArg(0));
+
+  B.SetInsertPoint(backwards);
+  byteLoop(B, move->getArg(0), move->getArg(1), nullptr, move->getArg(2), true);
+  B.CreateRet(move->getArg(0));
+}
+
+// The kernel starts _start with the stack aligned for a call rather than
+// just after one, so it's realigned on the way in.
+bool addRuntime(Module &m, std::string &error) {
+  Triple triple(m.getTargetTriple());
+  if(!triple.isOSLinux() || (triple.getArch() != Triple::x86_64 && triple.getArch() != Triple::aarch64)) {
+    error = "No runtime for " + triple.str();
+    return false;
+  }
+
+  auto main = m.getFunction("main");
+  if(main == nullptr) {
+    error = "The program has no main function";
+    return false;
+  }
+
+  for(auto name : { "_start", "memset", "memcpy", "memmove" }) {
+    if(m.getFunction(name) != nullptr) {
+      error = std::string("The program defines ") + name + ", which executables need for the runtime";
+      return false;
+    }
+  }
+
+  auto &C = m.getContext();
+  auto i32 = Type::getInt32Ty(C);
+  auto i64 = Type::getInt64Ty(C);
+
+  auto start = Function::Create(FunctionType::get(Type::getVoidTy(C), false), GlobalValue::ExternalLinkage,
+                                "_start", m);
+  start->addFnAttr(Attribute::NoReturn);
+  start->addFnAttr(Attribute::NoUnwind);
+  start->addFnAttr("stackrealign");
+
+  IRBuilder<> B(BasicBlock::Create(C, "entry", start));
+  auto argv = ConstantPointerNull::get(cast<PointerType>(main->getFunctionType()->getParamType(1)));
+  auto status = B.CreateZExt(B.CreateCall(main, { ConstantInt::get(i32, 0), argv }), i64);
+
+  // exit_group(status)
+  auto exitTy = FunctionType::get(Type::getVoidTy(C), { i64, i64 }, false);
+  InlineAsm *exit;
+  uint64_t number;
+  if(triple.getArch() == Triple::x86_64) {
+    exit = InlineAsm::get(exitTy, "syscall", "{rax},{rdi},~{rcx},~{r11},~{memory}", true);
+    number = 231;
+  } else {
+    exit = InlineAsm::get(exitTy, "svc #0", "{x8},{x0},~{memory}", true);
+    number = 94;
+  }
+
+  B.CreateCall(exit, { ConstantInt::get(i64, number), status });
+  B.CreateUnreachable();
+
+  addMemoryFunctions(m);
+  return true;
+}
+
+// The object goes to a temporary file, which is removed whether or not the
+// link succeeds.
+bool emitExecutable(Module &m, TargetMachine &machine, const std::string &path, std::string &error) {
+  m.setTargetTriple(machine.getTargetTriple().str());
+  if(!addRuntime(m, error)) {
+    return false;
+  }
+
+  auto linker = sys::findProgramByName("ld");
+  if(!linker) {
+    error = "No linker found: " + linker.getError().message();
+    return false;
+  }
+
+  int fd;
+  SmallString<128> object;
+  if(auto ec = sys::fs::createTemporaryFile("pbc", "o", fd, object)) {
+    error = "Couldn't create a temporary file: " + ec.message();
+    return false;
+  }
+
+  bool ok;
+  {
+    raw_fd_ostream os(fd, true);
+    ok = emit(m, machine, Output::Object, os, error);
+  }
+
+  if(ok) {
+    StringRef args[] = { *linker, "-static", "-e", "_start", "-o", path, object };
+    std::string message;
+    if(sys::ExecuteAndWait(*linker, args, None, {}, 0, 0, &message) != 0) {
+      error = message.empty() ? "Linking failed" : "Linking failed: " + message;
+      ok = false;
+    }
+  }
+
+  sys::fs::remove(object);
+  return ok;
+}
+
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <string>
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetMachine.h"
+
+namespace Compiler {
+
+enum class Output {
+  Object,
+  Assembly,
+  Bitcode,
+  IR,
+  Executable
+};
+
+// Reads the argument of --emit: obj, asm, bc, ll or exe.
+bool parseOutput(llvm::StringRef arg, Output &kind);
+
+// Extension of a file of the given kind, without the dot. Empty for
+// executables.
+llvm::StringRef extension(Output kind);
+
+// Writes the module as an object file, assembly, bitcode or textual IR for
+// the machine. Object files and assembly need a pass that the machine may
+// not have, in which case error says so.
+bool emit(llvm::Module &m, llvm::TargetMachine &machine, Output kind, llvm::raw_pwrite_stream &os,
+          std::string &error);
+
+// The runtime an executable needs on top of the program: an entry point
+// that calls main and exits with its result, making system calls directly,
+// and the memset, memcpy and memmove that optimized code calls, so that
+// nothing else has to be linked in. Only Linux on x86-64 and AArch64 is
+// supported.
+bool addRuntime(llvm::Module &m, std::string &error);
+
+// Adds the runtime, writes an object file and links it into a static
+// executable at path with the system linker.
+bool emitExecutable(llvm::Module &m, llvm::TargetMachine &machine, const std::string &path,
+                    std::string &error);
+
+}
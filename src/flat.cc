@@ -0,0 +1,193 @@
+#include "flat.hh"
+#include "stack.hh"
+
+namespace AST {
+
+using llvm::cast;
+
+FlatTree::FlatTree(Node *root) {
+  add(root);
+  firstLink.push_back(links.size());
+}
+
+size_t FlatTree::size() const {
+  return kinds.size();
+}
+
+llvm::ArrayRef<uint32_t> FlatTree::children(uint32_t node) const {
+  return llvm::makeArrayRef(links).slice(firstLink[node], firstLink[node + 1] - firstLink[node]);
+}
+
+int32_t FlatTree::value(uint32_t node) const {
+  return static_cast<int32_t>(payloads[node]);
+}
+
+llvm::StringRef FlatTree::name(uint32_t node) const {
+  if(kinds[node] == FunctionDeclKind) {
+    return names[decls[payloads[node]].name].str();
+  }
+
+  return names[payloads[node]].str();
+}
+
+size_t FlatTree::bytes() const {
+  size_t total = kinds.capacity() * sizeof(Kind) +
+    payloads.capacity() * sizeof(uint32_t) +
+    firstLink.capacity() * sizeof(uint32_t) +
+    links.capacity() * sizeof(uint32_t) +
+    decls.capacity() * sizeof(Decl) +
+    params.capacity() * sizeof(uint32_t) +
+    names.capacity() * sizeof(Symbol);
+
+  return total;
+}
+
+// A node's link slots are reserved when it's added, before any of its
+// children are, so that they stay contiguous.
+uint32_t FlatTree::open(Kind kind, uint32_t payload, size_t children) {
+  uint32_t node = kinds.size();
+  kinds.push_back(kind);
+  payloads.push_back(payload);
+  firstLink.push_back(links.size());
+  links.resize(links.size() + children);
+  return node;
+}
+
+void FlatTree::link(uint32_t node, size_t i, Node *child) {
+  auto index = add(child);
+  links[firstLink[node] + i] = index;
+}
+
+uint32_t FlatTree::add(Node *node) {
+  if(node == nullptr) {
+    return none;
+  }
+
+  if(Stack::low()) {
+    return Stack::fresh([&] { return add(node); });
+  }
+
+  switch(node->kind) {
+    case LiteralKind:
+      return open(LiteralKind, static_cast<uint32_t>(cast<Literal>(node)->value), 0);
+
+    case BooleanLiteralKind:
+      return open(BooleanLiteralKind, cast<BooleanLiteral>(node)->value, 0);
+
+    case VariableKind:
+      return open(VariableKind, intern(cast<Variable>(node)->name), 0);
+
+    case BinaryOpKind: {
+      auto op = cast<BinaryOp>(node);
+      auto n = open(BinaryOpKind, op->type, 2);
+      link(n, 0, op->left);
+      link(n, 1, op->right);
+      return n;
+    }
+
+    case UnaryOpKind: {
+      auto op = cast<UnaryOp>(node);
+      auto n = open(UnaryOpKind, op->type, 1);
+      link(n, 0, op->operand);
+      return n;
+    }
+
+    case DerefKind: {
+      auto n = open(DerefKind, 0, 1);
+      link(n, 0, cast<Deref>(node)->address);
+      return n;
+    }
+
+    case AssignKind: {
+      auto assign = cast<Assign>(node);
+      auto n = open(AssignKind, 0, 2);
+      link(n, 0, assign->location);
+      link(n, 1, assign->value);
+      return n;
+    }
+
+    case WhileLoopKind: {
+      auto loop = cast<WhileLoop>(node);
+      auto n = open(WhileLoopKind, 0, 2);
+      link(n, 0, loop->condition);
+      link(n, 1, loop->body);
+      return n;
+    }
+
+    case IfKind: {
+      auto branch = cast<If>(node);
+      auto n = open(IfKind, 0, 3);
+      link(n, 0, branch->condition);
+      link(n, 1, branch->trueBody);
+      link(n, 2, branch->falseBody);
+      return n;
+    }
+
+    case CallKind: {
+      auto call = cast<Call>(node);
+      auto n = open(CallKind, intern(call->name), call->args.size());
+      for(size_t i = 0; i < call->args.size(); ++i) {
+        link(n, i, call->args[i]);
+      }
+      return n;
+    }
+
+    case ReturnKind: {
+      auto n = open(ReturnKind, 0, 1);
+      link(n, 0, cast<Return>(node)->value);
+      return n;
+    }
+
+    case FunctionDeclKind: {
+      auto decl = cast<FunctionDecl>(node);
+      Decl d = { intern(decl->name), static_cast<uint32_t>(params.size()),
+                 static_cast<uint32_t>(decl->params.size()) };
+      for(auto p : decl->params) {
+        params.push_back(intern(p));
+      }
+
+      auto n = open(FunctionDeclKind, decls.size(), 1);
+      decls.push_back(d);
+      link(n, 0, decl->body);
+      return n;
+    }
+
+    case FunctionListKind: {
+      auto list = cast<FunctionList>(node);
+      auto n = open(FunctionListKind, 0, list->functions.size());
+      for(size_t i = 0; i < list->functions.size(); ++i) {
+        link(n, i, list->functions[i]);
+      }
+      return n;
+    }
+
+    case StatementListKind: {
+      auto list = cast<StatementList>(node);
+      auto n = open(StatementListKind, 0, list->statements.size());
+      for(size_t i = 0; i < list->statements.size(); ++i) {
+        link(n, i, list->statements[i]);
+      }
+      return n;
+    }
+
+    case ProgramKind: {
+      auto prog = cast<Program>(node);
+      auto n = open(ProgramKind, 0, 2);
+      link(n, 0, prog->functions);
+      link(n, 1, prog->body);
+      return n;
+    }
+  }
+
+  llvm_unreachable("unknown node kind");
+}
+
+uint32_t FlatTree::intern(Symbol name) {
+  auto it = ids.try_emplace(name, names.size());
+  if(it.second) {
+    names.push_back(name);
+  }
+  return it.first->second;
+}
+
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringRef.h"
+
+#include "ast.hh"
+
+namespace AST {
+
+// Compact copy of an AST. Nodes are numbered in preorder and stored as
+// parallel arrays: a kind byte, a 32-bit payload and a range of child
+// indices in one shared array. It holds no pointers, so walking it touches
+// only a few contiguous arrays and it can outlive the parser that built the
+// original.
+struct FlatTree {
+  // Stands in for an absent child, such as a missing else or return value.
+  static constexpr uint32_t none = UINT32_MAX;
+
+  struct Decl {
+    uint32_t name;
+    uint32_t firstParam;
+    uint32_t paramCount;
+  };
+
+  std::vector<Kind> kinds;
+
+  // By kind: the literal's value, the boolean, the operator type, an index
+  // into names for variables and calls, or into decls for declarations.
+  std::vector<uint32_t> payloads;
+
+  // Children of node i are links[firstLink[i], firstLink[i + 1]).
+  std::vector<uint32_t> firstLink;
+  std::vector<uint32_t> links;
+
+  // Each distinct name once, numbered from 0 in order of first use.
+  std::vector<Symbol> names;
+  std::vector<Decl> decls;
+  std::vector<uint32_t> params;
+
+  // The root is node 0.
+  FlatTree(Node *root);
+
+  size_t size() const;
+  llvm::ArrayRef<uint32_t> children(uint32_t node) const;
+
+  int32_t value(uint32_t node) const;
+  llvm::StringRef name(uint32_t node) const;
+
+  // Bytes held by the arrays and names.
+  size_t bytes() const;
+
+private:
+  llvm::DenseMap<Symbol, uint32_t> ids;
+
+  uint32_t add(Node *node);
+  uint32_t open(Kind kind, uint32_t payload, size_t children);
+  void link(uint32_t node, size_t i, Node *child);
+  uint32_t intern(Symbol name);
+};
+
+}
@@ -0,0 +1,326 @@
+#include <cstdint>
+#include <vector>
+
+#include "fold.hh"
+#include "stack.hh"
+
+using namespace llvm;
+
+namespace AST {
+
+// Whether evaluating node can't have an effect, which only a call can.
+static bool pure(Node *node) {
+  if(Stack::low()) {
+    return Stack::fresh([&] { return pure(node); });
+  }
+
+  switch(node->kind) {
+    case BinaryOpKind: {
+      auto op = cast<BinaryOp>(node);
+      return pure(op->left) && pure(op->right);
+    }
+    case UnaryOpKind:
+      return pure(cast<UnaryOp>(node)->operand);
+    case DerefKind:
+      return pure(cast<Deref>(node)->address);
+    case CallKind:
+      return false;
+    default:
+      return true;
+  }
+}
+
+static bool isInt(Node *node, int32_t value) {
+  auto lit = dyn_cast<Literal>(node);
+  return lit && lit->value == value;
+}
+
+static bool isBool(Node *node, bool value) {
+  auto lit = dyn_cast<BooleanLiteral>(node);
+  return lit && lit->value == value;
+}
+
+Folder::Folder() : rewrites(0) {}
+
+void Folder::fold(Program *program) {
+  visit(program);
+}
+
+Node *Folder::fold(Node *node) {
+  if(node == nullptr) {
+    return nullptr;
+  }
+
+  auto result = Stack::low() ? Stack::fresh([&] { return visit(node); }) : visit(node);
+  if(result != node) {
+    ++rewrites;
+  }
+
+  return result;
+}
+
+Node *Folder::visitLiteral(Literal *node) {
+  return node;
+}
+
+Node *Folder::visitBooleanLiteral(BooleanLiteral *node) {
+  return node;
+}
+
+Node *Folder::visitVariable(Variable *node) {
+  return node;
+}
+
+// Arithmetic wraps, as it does in the generated code.
+Node *Folder::literals(BinaryOp *node, int32_t left, int32_t right) {
+  uint32_t a = left;
+  uint32_t b = right;
+
+  switch(node->type) {
+    case Add:
+      return arena.make<Literal>(int32_t(a + b));
+    case Subtract:
+      return arena.make<Literal>(int32_t(a - b));
+    case Multiply:
+      return arena.make<Literal>(int32_t(a * b));
+    case Divide:
+    case Mod:
+      if(right == 0 || (left == INT32_MIN && right == -1)) {
+        return node;
+      }
+      return arena.make<Literal>(node->type == Divide ? left / right : left % right);
+    case Eq:
+      return arena.make<BooleanLiteral>(left == right);
+    case Neq:
+      return arena.make<BooleanLiteral>(left != right);
+    case Gt:
+      return arena.make<BooleanLiteral>(left > right);
+    case Lt:
+      return arena.make<BooleanLiteral>(left < right);
+    case GtEq:
+      return arena.make<BooleanLiteral>(left >= right);
+    case LtEq:
+      return arena.make<BooleanLiteral>(left <= right);
+    case And:
+      return arena.make<Literal>(left & right);
+    case Or:
+      return arena.make<Literal>(left | right);
+    default:
+      return node;
+  }
+}
+
+Node *Folder::booleans(BinaryOp *node, bool left, bool right) {
+  switch(node->type) {
+    case Eq:
+      return arena.make<BooleanLiteral>(left == right);
+    case Neq:
+      return arena.make<BooleanLiteral>(left != right);
+    case And:
+      return arena.make<BooleanLiteral>(left && right);
+    case Or:
+      return arena.make<BooleanLiteral>(left || right);
+    default:
+      return node;
+  }
+}
+
+Node *Folder::identity(BinaryOp *node) {
+  auto l = node->left;
+  auto r = node->right;
+
+  switch(node->type) {
+    case Add:
+      if(isInt(r, 0)) return l;
+      if(isInt(l, 0)) return r;
+      break;
+    case Subtract:
+      if(isInt(r, 0)) return l;
+      break;
+    case Multiply:
+      if(isInt(r, 1)) return l;
+      if(isInt(l, 1)) return r;
+      if(isInt(r, 0) && pure(l)) return r;
+      if(isInt(l, 0) && pure(r)) return l;
+      break;
+    case Divide:
+      if(isInt(r, 1)) return l;
+      break;
+    case And:
+      if(isBool(r, true)) return l;
+      if(isBool(l, true)) return r;
+      if(isBool(r, false) && pure(l)) return r;
+      if(isBool(l, false) && pure(r)) return l;
+      break;
+    case Or:
+      if(isBool(r, false)) return l;
+      if(isBool(l, false)) return r;
+      if(isBool(r, true) && pure(l)) return r;
+      if(isBool(l, true) && pure(r)) return l;
+      break;
+    default:
+      break;
+  }
+
+  return node;
+}
+
+Node *Folder::visitBinaryOp(BinaryOp *node) {
+  node->left = fold(node->left);
+  node->right = fold(node->right);
+
+  auto l = dyn_cast<Literal>(node->left);
+  auto r = dyn_cast<Literal>(node->right);
+  if(l && r) {
+    return literals(node, l->value, r->value);
+  }
+
+  auto lb = dyn_cast<BooleanLiteral>(node->left);
+  auto rb = dyn_cast<BooleanLiteral>(node->right);
+  if(lb && rb) {
+    return booleans(node, lb->value, rb->value);
+  }
+
+  return identity(node);
+}
+
+Node *Folder::visitUnaryOp(UnaryOp *node) {
+  node->operand = fold(node->operand);
+
+  if(node->type != Not) {
+    return node;
+  }
+
+  if(auto b = dyn_cast<BooleanLiteral>(node->operand)) {
+    return arena.make<BooleanLiteral>(!b->value);
+  }
+
+  if(auto lit = dyn_cast<Literal>(node->operand)) {
+    return arena.make<Literal>(~lit->value);
+  }
+
+  auto inner = dyn_cast<UnaryOp>(node->operand);
+  if(inner && inner->type == Not) {
+    return inner->operand;
+  }
+
+  return node;
+}
+
+Node *Folder::visitDeref(Deref *node) {
+  node->address = fold(node->address);
+  return node;
+}
+
+Node *Folder::visitAssign(Assign *node) {
+  if(isa<Deref>(node->location)) {
+    fold(node->location);
+  }
+
+  node->value = fold(node->value);
+  return node;
+}
+
+Node *Folder::visitWhileLoop(WhileLoop *node) {
+  node->condition = fold(node->condition);
+  if(isBool(node->condition, false)) {
+    return nullptr;
+  }
+
+  node->body = fold(node->body);
+  return node;
+}
+
+Node *Folder::visitIf(If *node) {
+  node->condition = fold(node->condition);
+  if(auto c = dyn_cast<BooleanLiteral>(node->condition)) {
+    return fold(c->value ? node->trueBody : node->falseBody);
+  }
+
+  node->trueBody = fold(node->trueBody);
+  node->falseBody = fold(node->falseBody);
+  return node;
+}
+
+Node *Folder::visitCall(Call *node) {
+  std::vector<Node *> args;
+  bool changed = false;
+
+  for(size_t i = 0; i < node->args.size(); ++i) {
+    auto arg = node->args[i];
+    auto folded = fold(arg);
+
+    if(folded != arg && !changed) {
+      changed = true;
+      args.assign(node->args.begin(), node->args.begin() + i);
+    }
+
+    if(changed) {
+      args.push_back(folded);
+    }
+  }
+
+  if(changed) {
+    node->args = arena.copy(makeArrayRef(args));
+  }
+
+  return node;
+}
+
+Node *Folder::visitReturn(Return *node) {
+  node->value = fold(node->value);
+  return node;
+}
+
+Node *Folder::visitFunctionDecl(FunctionDecl *node) {
+  node->body = fold(node->body);
+  return node;
+}
+
+Node *Folder::visitFunctionList(FunctionList *node) {
+  for(auto f : node->functions) {
+    visit(f);
+  }
+
+  return node;
+}
+
+// Statements are only copied into a new list once one of them changes.
+Node *Folder::visitStatementList(StatementList *node) {
+  std::vector<Node *> kept;
+  bool changed = false;
+
+  for(size_t i = 0; i < node->statements.size(); ++i) {
+    auto stmt = node->statements[i];
+    auto folded = fold(stmt);
+
+    if(folded != stmt && !changed) {
+      changed = true;
+      kept.assign(node->statements.begin(), node->statements.begin() + i);
+    }
+
+    if(!changed || folded == nullptr) {
+      continue;
+    }
+
+    if(auto list = dyn_cast<StatementList>(folded)) {
+      kept.insert(kept.end(), list->statements.begin(), list->statements.end());
+    } else {
+      kept.push_back(folded);
+    }
+  }
+
+  if(changed) {
+    node->statements = arena.copy(makeArrayRef(kept));
+  }
+
+  return node;
+}
+
+Node *Folder::visitProgram(Program *node) {
+  node->functions = fold(node->functions);
+  node->body = fold(node->body);
+  return node;
+}
+
+}
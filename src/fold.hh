@@ -0,0 +1,55 @@
+#pragma once
+
+#include "arena.hh"
+#include "ast.hh"
+
+namespace AST {
+
+// Evaluates operators whose operands are literals, applies identities such
+// as x * 1, x + 0 and not not b, and drops the branches of ifs and whiles
+// that can never run. Lists whose statements change are rewritten in place;
+// nodes the folder makes, and the new lists, live in its arena, so it has to
+// outlive the tree it folded.
+//
+// Runs after the Resolver, so variables only read or assigned in code that
+// gets pruned still have slots, and errors in that code are still reported.
+// Division and modulo by zero are left for the program to do at run time,
+// and an operand is only dropped if evaluating it can't call anything.
+struct Folder : public Visitor<Folder, Node *> {
+  // Nodes replaced or removed so far.
+  size_t rewrites;
+
+  Folder();
+
+  void fold(Program *program);
+
+  // The node to use in place of node, or null if a statement was removed
+  // entirely. A pruned if can leave a StatementList behind, which is spliced
+  // into the enclosing list.
+  Node *fold(Node *node);
+
+  Node *visitLiteral(Literal *node);
+  Node *visitBooleanLiteral(BooleanLiteral *node);
+  Node *visitVariable(Variable *node);
+  Node *visitBinaryOp(BinaryOp *node);
+  Node *visitUnaryOp(UnaryOp *node);
+  Node *visitDeref(Deref *node);
+  Node *visitAssign(Assign *node);
+  Node *visitWhileLoop(WhileLoop *node);
+  Node *visitIf(If *node);
+  Node *visitCall(Call *node);
+  Node *visitReturn(Return *node);
+  Node *visitFunctionDecl(FunctionDecl *node);
+  Node *visitFunctionList(FunctionList *node);
+  Node *visitStatementList(StatementList *node);
+  Node *visitProgram(Program *node);
+
+private:
+  Arena arena;
+
+  Node *literals(BinaryOp *node, int32_t left, int32_t right);
+  Node *booleans(BinaryOp *node, bool left, bool right);
+  Node *identity(BinaryOp *node);
+};
+
+}
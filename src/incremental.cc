@@ -0,0 +1,161 @@
+#include <algorithm>
+
+#include "incremental.hh"
+
+IncrementalParser::IncrementalParser(std::string source) :
+  text(std::move(source))
+{
+  parseAll();
+}
+
+AST::Program *IncrementalParser::program() const {
+  return root.get();
+}
+
+const std::string &IncrementalParser::source() const {
+  return text;
+}
+
+AST::Program *IncrementalParser::apply(const Edit &edit) {
+  // The edited lines of the old text. Everything outside them is unchanged,
+  // apart from moving by delta bytes.
+  auto newline = edit.offset == 0 ? std::string::npos : text.rfind('\n', edit.offset - 1);
+  size_t begin = newline == std::string::npos ? 0 : newline + 1;
+
+  newline = text.find('\n', edit.offset + edit.length);
+  size_t end = newline == std::string::npos ? text.size() : newline + 1;
+
+  text.replace(edit.offset, edit.length, edit.text);
+  auto delta = static_cast<ptrdiff_t>(edit.text.size()) - static_cast<ptrdiff_t>(edit.length);
+
+  if(!root) {
+    parseAll();
+    return program();
+  }
+
+  // Units overlapping the edited lines are reparsed along with them.
+  size_t first = std::upper_bound(units.begin(), units.end(), begin,
+      [](size_t offset, const Unit &u) { return offset < u.end; }) - units.begin();
+  size_t last = std::lower_bound(units.begin() + first, units.end(), end,
+      [](const Unit &u, size_t offset) { return u.begin < offset; }) - units.begin();
+
+  if(first < last) {
+    begin = std::min(begin, units[first].begin);
+    end = std::max(end, units[last - 1].end);
+  }
+
+  vector<Unit> fresh;
+  if(!parseRange(begin, end + delta, fresh)) {
+    parseAll();
+    return program();
+  }
+
+  // Declarations still have to come before every statement.
+  bool hasFunctions = !fresh.empty() && fresh.front().function;
+  bool hasStatements = !fresh.empty() && !fresh.back().function;
+  if((hasFunctions && first > 0 && !units[first - 1].function) ||
+     (hasStatements && last < units.size() && units[last].function))
+  {
+    parseAll();
+    return program();
+  }
+
+  auto &fs = declared;
+  auto &ss = body;
+  size_t count = fs.size();
+
+  size_t fBegin = std::min<size_t>(first, count);
+  size_t fEnd = std::min<size_t>(last, count);
+  size_t sBegin = std::max<size_t>(first, count) - count;
+  size_t sEnd = std::max<size_t>(last, count) - count;
+
+  vector<AST::Node *> freshFunctions;
+  vector<AST::Node *> freshStatements;
+  for(auto &u : fresh) {
+    (u.function ? freshFunctions : freshStatements).push_back(u.node);
+  }
+
+  fs.erase(fs.begin() + fBegin, fs.begin() + fEnd);
+  fs.insert(fs.begin() + fBegin, freshFunctions.begin(), freshFunctions.end());
+  ss.erase(ss.begin() + sBegin, ss.begin() + sEnd);
+  ss.insert(ss.begin() + sBegin, freshStatements.begin(), freshStatements.end());
+
+  functions->functions = fs;
+  statements->statements = ss;
+
+  for(size_t i = last; i < units.size(); ++i) {
+    units[i].begin += delta;
+    units[i].end += delta;
+  }
+
+  units.erase(units.begin() + first, units.begin() + last);
+  units.insert(units.begin() + first, std::make_move_iterator(fresh.begin()),
+               std::make_move_iterator(fresh.end()));
+
+  return program();
+}
+
+void IncrementalParser::parseAll() {
+  units.clear();
+  declared.clear();
+  body.clear();
+  root.reset();
+  functions.reset();
+  statements.reset();
+  errors.clear();
+
+  vector<Unit> all;
+  if(!parseRange(0, text.size(), all)) {
+    return;
+  }
+
+  for(auto &u : all) {
+    (u.function ? declared : body).push_back(u.node);
+  }
+
+  units = std::move(all);
+  functions = std::make_unique<AST::FunctionList>(declared);
+  statements = std::make_unique<AST::StatementList>(body);
+  root = std::make_unique<AST::Program>(functions.get(), statements.get());
+}
+
+// Parses text[begin, end), which must be made of whole lines, and appends
+// its units to out. Error messages are only kept for the whole file, since
+// the lines in them are relative to begin.
+bool IncrementalParser::parseRange(size_t begin, size_t end, vector<Unit> &out) {
+  auto parser = std::make_shared<Parser>(std::string_view(text).substr(begin, end - begin));
+  auto prog = parser->parseProgram();
+
+  if(prog == nullptr) {
+    if(begin == 0 && end == text.size()) {
+      errors = parser->errors;
+    }
+    return false;
+  }
+
+  auto fs = static_cast<AST::FunctionList *>(prog->functions)->functions;
+  auto ss = static_cast<AST::StatementList *>(prog->body)->statements;
+  auto ranges = parser->topLevelUnits();
+
+  if(ranges.size() != fs.size() + ss.size()) {
+    return false;
+  }
+
+  auto &tokens = parser->tokens;
+  auto &lines = parser->lines;
+
+  for(size_t i = 0; i < ranges.size(); ++i) {
+    auto first = tokens[ranges[i].first].offset;
+    auto last = tokens[ranges[i].second - 1].offset;
+
+    Unit u;
+    u.begin = begin + lines.starts[lines.lineOf(first) - 1];
+    u.end = std::min(begin + last + 1, end);
+    u.function = i < fs.size();
+    u.node = u.function ? fs[i] : ss[i - fs.size()];
+    u.owner = parser;
+    out.push_back(std::move(u));
+  }
+
+  return true;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ast.hh"
+#include "parser.hh"
+
+// Replaces length bytes of the source at offset with text.
+struct Edit {
+  size_t offset;
+  size_t length;
+  std::string text;
+};
+
+// A parsed source file that can be edited. Each top level function
+// declaration and statement remembers the lines it was parsed from, so an
+// edit reparses only the units whose lines it touches and reuses the rest
+// as they are. An edit that doesn't leave those lines as a sequence of whole
+// units, such as one that removes an end, falls back to parsing the whole
+// file.
+struct IncrementalParser {
+  vector<string> errors;
+
+  IncrementalParser(std::string source);
+
+  // The current AST, or nullptr if the source has a syntax error.
+  AST::Program *program() const;
+  const std::string &source() const;
+
+  AST::Program *apply(const Edit &edit);
+
+private:
+  struct Unit {
+    size_t begin;
+    size_t end;
+    AST::Node *node;
+    bool function;
+
+    // Owns the node; shared by every unit parsed alongside it.
+    std::shared_ptr<Parser> owner;
+  };
+
+  std::string text;
+  vector<Unit> units;
+
+  // Nodes of the units, viewed by the lists below.
+  vector<AST::Node *> declared;
+  vector<AST::Node *> body;
+
+  std::unique_ptr<AST::FunctionList> functions;
+  std::unique_ptr<AST::StatementList> statements;
+  std::unique_ptr<AST::Program> root;
+
+  void parseAll();
+  bool parseRange(size_t begin, size_t end, vector<Unit> &out);
+};
@@ -0,0 +1,66 @@
+#include "llvm/ExecutionEngine/Orc/ExecutionUtils.h"
+#include "llvm/ExecutionEngine/Orc/LLJIT.h"
+#include "llvm/Support/TargetSelect.h"
+
+#include "jit.hh"
+
+using namespace llvm;
+
+namespace Compiler {
+
+static Expected<std::unique_ptr<orc::LLJIT>> create(bool lazy) {
+  if(!lazy) {
+    return orc::LLJITBuilder().create();
+  }
+
+  auto jit = orc::LLLazyJITBuilder().create();
+  if(!jit) {
+    return jit.takeError();
+  }
+
+  // Each function is pulled out into a module of its own and compiled when
+  // it's first called, through a stub that the JIT then points at the code.
+  (*jit)->setPartitionFunction(orc::CompileOnDemandLayer::compileRequested);
+  return std::unique_ptr<orc::LLJIT>(std::move(*jit));
+}
+
+// Optimized code can call memset and friends, so symbols the module doesn't
+// define are looked up in the process.
+bool run(State &s, int &result, std::string &error, bool lazy) {
+  InitializeNativeTarget();
+  InitializeNativeTargetAsmPrinter();
+
+  auto jit = create(lazy);
+  if(!jit) {
+    error = toString(jit.takeError());
+    return false;
+  }
+
+  auto &layout = (*jit)->getDataLayout();
+  auto process = orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(layout.getGlobalPrefix());
+  if(!process) {
+    error = toString(process.takeError());
+    return false;
+  }
+  (*jit)->getMainJITDylib().addGenerator(std::move(*process));
+
+  s.Mod->setDataLayout(layout);
+  orc::ThreadSafeModule module(std::move(s.Mod), orc::ThreadSafeContext(std::move(s.context)));
+  auto added = lazy ? static_cast<orc::LLLazyJIT &>(**jit).addLazyIRModule(std::move(module))
+                    : (*jit)->addIRModule(std::move(module));
+  if(added) {
+    error = toString(std::move(added));
+    return false;
+  }
+
+  auto main = (*jit)->lookup("main");
+  if(!main) {
+    error = toString(main.takeError());
+    return false;
+  }
+
+  result = reinterpret_cast<int (*)(int, char **)>(main->getAddress())(0, nullptr);
+  return true;
+}
+
+}
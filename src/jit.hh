@@ -0,0 +1,20 @@
+#pragma once
+
+#include <string>
+
+#include "compiler.hh"
+
+namespace Compiler {
+
+// Compiles the state's module in this process and calls main, setting
+// result to what it returns: memory[0], unless the program returned early.
+// The module and its context are handed over to the JIT, so nothing more can
+// be compiled into the state afterwards. False, with the reason in error,
+// if the JIT can't be set up or the module can't be linked.
+//
+// If lazy, only main is compiled up front, and every other function the
+// first time it's called, so start-up costs what runs rather than the whole
+// program.
+bool run(State &s, int &result, std::string &error, bool lazy = false);
+
+}
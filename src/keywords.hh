@@ -0,0 +1,178 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "lexer.hh"
+
+// Compile-time generated recognisers for the fixed spellings of the language.
+// Keywords are found with a perfect hash over their bytes packed into a single
+// word, and operators with a byte-indexed state table, so neither needs to
+// allocate or look at an input byte more than once.
+
+namespace Lex {
+
+struct Spelling {
+  const char *text;
+  TokenType type;
+};
+
+constexpr Spelling keywordSpellings[] = {
+  { "if", If },
+  { "else", Else },
+  { "while", While },
+  { "function", Function },
+  { "return", Return },
+  { "end", End },
+  { "true", True },
+  { "false", False },
+  { "not", Not },
+  { "and", And },
+  { "or", Or }
+};
+
+constexpr Spelling operatorSpellings[] = {
+  { "+", Plus },
+  { "-", Minus },
+  { "*", Star },
+  { "/", Slash },
+  { "%", Percent },
+  { "=", Eq },
+  { "!=", Neq },
+  { ">", Gt },
+  { "<", Lt },
+  { ">=", GtEq },
+  { "<=", LtEq },
+  { "<-", Arrow },
+  { "(", LeftParen },
+  { ")", RightParen },
+  { "[", LeftBracket },
+  { "]", RightBracket },
+  { ",", Comma }
+};
+
+constexpr size_t spellingLength(const char *text) {
+  size_t length = 0;
+  while(text[length] != '\0') {
+    length++;
+  }
+  return length;
+}
+
+// Little-endian packing of the first eight bytes of a word. Every keyword
+// fits, so two keyword-length words are equal exactly when their packings are.
+constexpr uint64_t packByte(uint64_t packed, size_t index, char ch) {
+  return packed | (static_cast<uint64_t>(static_cast<unsigned char>(ch)) << (8 * index));
+}
+
+constexpr uint64_t pack(const char *text) {
+  uint64_t packed = 0;
+  for(size_t i = 0; text[i] != '\0'; ++i) {
+    packed = packByte(packed, i, text[i]);
+  }
+  return packed;
+}
+
+constexpr size_t maxKeywordLength = 8;
+constexpr unsigned keywordSlotBits = 5;
+constexpr size_t keywordSlots = size_t(1) << keywordSlotBits;
+
+constexpr size_t keywordSlot(uint64_t packed, uint64_t multiplier) {
+  return (packed * multiplier) >> (64 - keywordSlotBits);
+}
+
+constexpr bool isPerfect(uint64_t multiplier) {
+  bool used[keywordSlots] = {};
+  for(auto &kw : keywordSpellings) {
+    auto slot = keywordSlot(pack(kw.text), multiplier);
+    if(used[slot]) {
+      return false;
+    }
+    used[slot] = true;
+  }
+  return true;
+}
+
+constexpr uint64_t findMultiplier() {
+  uint64_t multiplier = 0x9e3779b97f4a7c15ull;
+  while(!isPerfect(multiplier)) {
+    multiplier += 0x5851f42d4c957f2eull;
+  }
+  return multiplier;
+}
+
+struct KeywordTable {
+  uint64_t multiplier;
+  uint64_t packed[keywordSlots];
+  TokenType type[keywordSlots];
+};
+
+constexpr KeywordTable makeKeywordTable() {
+  KeywordTable table = {};
+  table.multiplier = findMultiplier();
+
+  for(auto &slotType : table.type) {
+    slotType = Identifier;
+  }
+
+  for(auto &kw : keywordSpellings) {
+    auto slot = keywordSlot(pack(kw.text), table.multiplier);
+    table.packed[slot] = pack(kw.text);
+    table.type[slot] = kw.type;
+  }
+
+  return table;
+}
+
+constexpr KeywordTable keywordTable = makeKeywordTable();
+
+// The token type of a word given its packed bytes and length: the keyword it
+// spells, or Identifier.
+constexpr TokenType keywordType(uint64_t packed, size_t length) {
+  if(length > maxKeywordLength) {
+    return Identifier;
+  }
+
+  auto slot = keywordSlot(packed, keywordTable.multiplier);
+  return keywordTable.packed[slot] == packed ? keywordTable.type[slot] : Identifier;
+}
+
+// One state per possible first byte of an operator: the token it forms on its
+// own, and the second bytes that extend it to a two byte operator.
+struct OperatorState {
+  TokenType single;
+  size_t pairs;
+  char second[2];
+  TokenType pair[2];
+};
+
+struct OperatorTable {
+  OperatorState states[256];
+};
+
+constexpr OperatorTable makeOperatorTable() {
+  OperatorTable table = {};
+  for(auto &state : table.states) {
+    state.single = Unknown;
+  }
+
+  for(auto &op : operatorSpellings) {
+    auto &state = table.states[static_cast<unsigned char>(op.text[0])];
+    if(spellingLength(op.text) == 1) {
+      state.single = op.type;
+    } else {
+      state.second[state.pairs] = op.text[1];
+      state.pair[state.pairs] = op.type;
+      state.pairs++;
+    }
+  }
+
+  return table;
+}
+
+constexpr OperatorTable operatorTable = makeOperatorTable();
+
+static_assert(keywordType(pack("function"), 8) == Function, "keyword table is not perfect");
+static_assert(keywordType(pack("iff"), 3) == Identifier, "keyword table accepts non-keywords");
+
+}
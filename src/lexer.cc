@@ -0,0 +1,147 @@
+#include "lexer.hh"
+#include "keywords.hh"
+#include "structure.hh"
+#include "symbol.hh"
+
+#include <algorithm>
+
+namespace Lex {
+
+// Source is indexed a chunk at a time so the structural offsets stay in
+// cache and never need to be held for the whole file.
+static constexpr size_t chunkSize = 1024 * StructuralIndexer::blockSize;
+
+Lexer::Lexer(std::string_view source) :
+  source(source), index(0)
+{
+  tokens.reserve(source.size() / 4);
+  lines.starts.push_back(0);
+
+  StructuralIndexer indexer;
+  std::vector<uint32_t> starts(std::min(chunkSize, source.size()));
+
+  for(size_t chunk = 0; chunk < source.size(); chunk += chunkSize) {
+    auto end = std::min(chunk + chunkSize, source.size());
+    auto count = indexer.index(source, chunk, end, starts.data());
+
+    for(size_t i = 0; i < count; ++i) {
+      auto start = starts[i];
+
+      // Already consumed as part of a longer operator, or of a number
+      // followed by an identifier.
+      if(start < index) {
+        continue;
+      }
+
+      index = start;
+      char ch = source[index];
+
+      if(ch == '\n') {
+        if(!tokens.empty() && tokens.back().type != Newline) {
+          push(Newline, index);
+        }
+        index++;
+        lines.starts.push_back(index);
+      } else if(isIdentifier(ch)) {
+        lexWord();
+      } else {
+        lexOperator();
+      }
+    }
+  }
+
+  index = source.size();
+  if(!tokens.empty() && tokens.back().type != Newline) {
+    push(Newline, index);
+  }
+  push(EndOfFile, index);
+
+  // The cache's keys point into the source, which may not outlive us.
+  ids = {};
+}
+
+// A word is a run of identifier bytes, which may be a number immediately
+// followed by an identifier.
+void Lexer::lexWord() {
+  if(isDigit(source[index])) {
+    lexNumber();
+  }
+
+  if(index < source.size() && isIdentifier(source[index])) {
+    lexIdentifier();
+  }
+}
+
+void Lexer::lexIdentifier() {
+  auto begin = index;
+  uint64_t packed = 0;
+  while(index < source.size() && isIdentifier(source[index])) {
+    if(index - begin < maxKeywordLength) {
+      packed = packByte(packed, index - begin, source[index]);
+    }
+    index++;
+  }
+
+  auto type = keywordType(packed, index - begin);
+  if(type != Identifier) {
+    push(type, begin);
+  } else {
+    push(Identifier, begin, intern(source.substr(begin, index - begin)));
+  }
+}
+
+void Lexer::lexNumber() {
+  auto begin = index;
+  uint64_t value = 0;
+  while(index < source.size() && isDigit(source[index])) {
+    value = std::min<uint64_t>(value * 10 + (source[index++] - '0'), UINT32_MAX);
+  }
+
+  push(Number, begin, static_cast<uint32_t>(value));
+}
+
+void Lexer::lexOperator() {
+  auto begin = index;
+  auto &state = operatorTable.states[static_cast<unsigned char>(source[index++])];
+
+  if(index < source.size()) {
+    for(size_t i = 0; i < state.pairs; ++i) {
+      if(source[index] == state.second[i]) {
+        index++;
+        return push(state.pair[i], begin);
+      }
+    }
+  }
+
+  push(state.single, begin);
+}
+
+void Lexer::push(TokenType type, size_t begin, uint32_t value) {
+  tokens.push_back({ static_cast<uint32_t>(begin), value, type });
+}
+
+uint32_t Lexer::intern(std::string_view name) {
+  auto it = ids.find(name);
+  if(it != ids.end()) {
+    return it->second;
+  }
+
+  uint32_t id = Symbol::intern(name).id;
+  ids.emplace(name, id);
+  return id;
+}
+
+uint32_t LineIndex::lineOf(uint32_t offset) const {
+  auto it = std::upper_bound(starts.begin(), starts.end(), offset);
+  return it - starts.begin();
+}
+
+bool Lexer::isIdentifier(char ch) {
+  return byteClasses[static_cast<unsigned char>(ch)] == WordByte;
+}
+
+bool Lexer::isDigit(char ch) {
+  return ch >= '0' && ch <= '9';
+}
+
+}
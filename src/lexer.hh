@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace Lex {
+
+enum TokenType : uint8_t {
+  Identifier,
+  Number,
+
+  If,
+  Else,
+  While,
+  Function,
+  Return,
+  End,
+  True,
+  False,
+  Not,
+  And,
+  Or,
+
+  Plus,
+  Minus,
+  Star,
+  Slash,
+  Percent,
+  Eq,
+  Neq,
+  Gt,
+  Lt,
+  GtEq,
+  LtEq,
+  Arrow,
+  LeftParen,
+  RightParen,
+  LeftBracket,
+  RightBracket,
+  Comma,
+
+  Newline,
+  Unknown,
+  EndOfFile
+};
+
+struct Token {
+  uint32_t offset;
+
+  // Symbol id for identifiers, and for numbers the decoded magnitude, which
+  // saturates at UINT32_MAX. Signs are separate tokens, so the parser does
+  // the range check.
+  uint32_t value;
+
+  TokenType type;
+};
+
+// Byte offset at which each line of the source starts, so that line numbers
+// don't have to be stored per token.
+struct LineIndex {
+  std::vector<uint32_t> starts;
+
+  // 1-based line containing the given byte offset.
+  uint32_t lineOf(uint32_t offset) const;
+};
+
+// Turns source text into a flat token vector in a single pass. Blank lines
+// are dropped, so a Newline token always terminates a non-empty line and the
+// stream always finishes with EndOfFile.
+struct Lexer {
+  std::vector<Token> tokens;
+  LineIndex lines;
+
+  Lexer(std::string_view source);
+
+private:
+  std::string_view source;
+  size_t index;
+
+  // Symbols already interned by this lexer, so that the shared table is only
+  // locked once per distinct name. Keys are views into the source.
+  std::unordered_map<std::string_view, uint32_t> ids;
+
+  void lexWord();
+  void lexIdentifier();
+  void lexNumber();
+  void lexOperator();
+  void push(TokenType type, size_t begin, uint32_t value = 0);
+  uint32_t intern(std::string_view name);
+
+  static bool isIdentifier(char ch);
+  static bool isDigit(char ch);
+};
+
+}
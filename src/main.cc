@@ -1,10 +1,24 @@
-#include <iostream>
 #include <fstream>
+#include <memory>
+#include <sys/stat.h>
+#include <iostream>
 #include "optionparser.h"
 
+#include "llvm/IR/Verifier.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+
 #include "ast.hh"
+#include "cache.hh"
+#include "emit.hh"
+#include "jit.hh"
 #include "parser.hh"
+#include "passes.hh"
 #include "compiler.hh"
+#include "flat.hh"
+#include "optimize.hh"
+#include "source.hh"
+#include "stream.hh"
 
 using Compiler::State;
 
@@ -22,17 +36,283 @@ struct Arg : public option::Arg {
     if (msg) printError("Option '", option, "' requires an argument\n");
     return option::ARG_ILLEGAL;
   }
+
+  static option::ArgStatus Level(const option::Option& option, bool msg) {
+    llvm::OptimizationLevel level;
+    if (option.arg != 0 && Compiler::parseLevel(option.arg, level))
+      return option::ARG_OK;
+
+    if (msg) printError("Option '", option, "' takes 0, 1, 2, 3 or s\n");
+    return option::ARG_ILLEGAL;
+  }
+
+  static option::ArgStatus Emit(const option::Option& option, bool msg) {
+    Compiler::Output kind;
+    if (option.arg != 0 && Compiler::parseOutput(option.arg, kind))
+      return option::ARG_OK;
+
+    if (msg) printError("Option '", option, "' takes obj, asm, bc, ll or exe\n");
+    return option::ARG_ILLEGAL;
+  }
 };
 
-enum OptionIndex { UNKNOWN, PARSE, FILE_NAME, HELP };
+enum OptionIndex { UNKNOWN, PARSE, STREAM, CACHE, CACHE_DIR, SHARE, OPTIMIZE, EMIT, OUTPUT, RUN, LAZY, TIME_PASSES, FILE_NAME, HELP };
 const option::Descriptor usage[] = {
   { UNKNOWN, 0, "", "", option::Arg::None, "USAGE: pbc files [options]"
                                             "\n\nOptions:"},
   { PARSE, 0, "", "parse", option::Arg::None, "  --parse: Only parse the file" },
+  { STREAM, 0, "", "stream", option::Arg::None, "  --stream: Parse and compile one top level unit at a time, "
+                                                "reading standard input if no file is given. "
+                                                "Can't be used with --share, --time-passes or caching" },
+  { CACHE, 0, "", "cache", option::Arg::None, "  --cache: Reuse the parsed program saved next to the file, "
+                                              "or save it there" },
+  { CACHE_DIR, 0, "", "cache-dir", Arg::Required, "  --cache-dir=<dir>: As --cache, but keep saved programs in "
+                                                  "<dir>, named by the hash of their source" },
+  { SHARE, 0, "", "share", option::Arg::None, "  --share: Compute identical expressions once when nothing "
+                                              "they read can have changed in between" },
+  { OPTIMIZE, 0, "O", "", Arg::Level, "  -O<level>: Optimize at level 0, 1, 2 or 3, or for size with s. "
+                                      "Nothing is optimized by default" },
+  { EMIT, 0, "", "emit", Arg::Emit, "  --emit=<kind>: Write an object file, assembly, bitcode, textual IR or a "
+                                     "linked executable: obj, asm, bc, ll or exe" },
+  { OUTPUT, 0, "o", "", Arg::Required, "  -o <file>: Write output to <file>, or standard output for - "
+                                       "unless it's an executable. "
+                                       "Without --emit, an executable is written. Without either, "
+                                       "the IR goes to standard error" },
+  { RUN, 0, "", "run", option::Arg::None, "  --run: Compile the program in memory and run it instead of writing "
+                                         "it out. Its result is the exit status" },
+  { LAZY, 0, "", "lazy", option::Arg::None, "  --lazy: Like --run, but compile each function only when it is "
+                                           "first called" },
+  { TIME_PASSES, 0, "", "time-passes", option::Arg::None, "  --time-passes: Report the time, node counts and heap "
+                                                          "growth of each compiler pass" },
   { HELP, 0, "h", "help", option::Arg::None, "  --help: Display this message" },
   { 0, 0, 0, 0, 0, 0 }
 };
 
+// Code that fails to verify is a bug in the compiler rather than the
+// program, but it's better reported than handed on.
+static bool verified(State &s) {
+  if(verifyModule(*s.Mod, &errs())) {
+    std::cout << "Internal error: generated code is invalid" << std::endl;
+    return false;
+  }
+
+  return true;
+}
+
+static llvm::OptimizationLevel level(option::Option *options) {
+  auto level = llvm::OptimizationLevel::O0;
+  if(options[OPTIMIZE]) {
+    Compiler::parseLevel(options[OPTIMIZE].last()->arg, level);
+  }
+  return level;
+}
+
+// Output is named after the input unless -o says otherwise.
+static std::string outputPath(option::Option *options, Compiler::Output kind, const std::string &fname) {
+  if(options[OUTPUT]) {
+    return options[OUTPUT].last()->arg;
+  }
+
+  if(kind == Compiler::Output::Executable) {
+    return "a.out";
+  }
+
+  auto stem = fname == "<stdin>" ? StringRef("out") : sys::path::stem(fname);
+  return (stem + "." + Compiler::extension(kind)).str();
+}
+
+// Runs the module for --run or --lazy, or writes it out as --emit and -o ask.
+// Anything but the old dump of IR to standard error needs a machine for the
+// host.
+static int output(option::Option *options, State &s, TargetMachine *machine,
+                  const std::string &targetError, const std::string &fname) {
+  if(options[RUN] || options[LAZY]) {
+    int result;
+    std::string error;
+    if(!Compiler::run(s, result, error, options[LAZY])) {
+      std::cout << error << std::endl;
+      return 1;
+    }
+    return result;
+  }
+
+  if(!options[EMIT] && !options[OUTPUT]) {
+    s.Mod->print(errs(), nullptr);
+    return 0;
+  }
+
+  auto kind = Compiler::Output::Executable;
+  if(options[EMIT]) {
+    Compiler::parseOutput(options[EMIT].last()->arg, kind);
+  }
+
+  if(machine == nullptr) {
+    std::cout << "No target for the host: " << targetError << std::endl;
+    return 1;
+  }
+
+  auto path = outputPath(options, kind, fname);
+  if(kind == Compiler::Output::Executable && path == "-") {
+    std::cout << "Executables can't be written to standard output" << std::endl;
+    return 1;
+  }
+  std::string error;
+  bool ok;
+
+  if(kind == Compiler::Output::Executable) {
+    ok = Compiler::emitExecutable(*s.Mod, *machine, path, error);
+  } else {
+    std::error_code ec;
+    bool binary = kind == Compiler::Output::Object || kind == Compiler::Output::Bitcode;
+    raw_fd_ostream os(path, ec, binary ? sys::fs::OF_None : sys::fs::OF_Text);
+    if(ec) {
+      std::cout << "The file " << path << " could not be written: " << ec.message() << std::endl;
+      return 1;
+    }
+    ok = Compiler::emit(*s.Mod, *machine, kind, os, error);
+  }
+
+  if(!ok) {
+    std::cout << error << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
+
+int stream(option::Option *options, std::string fname) {
+  std::ifstream file;
+  if(fname != "-") {
+    file.open(fname);
+    if(!file) {
+      std::cout << "The file " << fname << " could not be read" << std::endl;
+      return 1;
+    }
+  } else {
+    std::ios::sync_with_stdio(false);
+    fname = "<stdin>";
+  }
+
+  Pipeline p(file.is_open() ? file : std::cin);
+  State s;
+
+  bool ok = options[PARSE] ? p.parse() : p.compile(s);
+  if(!ok) {
+    std::cout << "Syntax error" << std::endl;
+    for(auto &e : p.errors) {
+      std::cout << fname << ": " << e << std::endl;
+    }
+    return 1;
+  }
+
+  if(options[PARSE]) {
+    std::cout << "Successful parse" << std::endl;
+    return 0;
+  }
+
+  if(!verified(s)) {
+    return 1;
+  }
+
+  std::string targetError;
+  auto machine = Compiler::hostMachine(targetError);
+  Compiler::optimize(*s.Mod, level(options), machine.get());
+  return output(options, s, machine.get(), targetError, fname);
+}
+
+// Parses the file, or loads it from the cache if caching is on and the
+// source hasn't changed since it was saved.
+int compile(option::Option *options, std::string fname) {
+  auto source = SourceFile::open(fname);
+  if(!source) {
+    std::cout << "The file " << fname << " could not be read" << std::endl;
+    return 0;
+  }
+
+  bool caching = options[CACHE] || options[CACHE_DIR];
+  auto key = AST::CachedProgram::Key{};
+  std::string cache;
+  std::unique_ptr<AST::CachedProgram> cached;
+  AST::Program *ast = nullptr;
+
+  if(caching) {
+    key = AST::CachedProgram::Key::of(source->text());
+    cache = AST::CachedProgram::path(options[CACHE_DIR] ? options[CACHE_DIR].arg : "", fname, key);
+    cached = AST::CachedProgram::load(cache, key);
+    ast = cached ? cached->program() : nullptr;
+  }
+
+  std::unique_ptr<Parser> p;
+  if(ast == nullptr) {
+    p = std::make_unique<Parser>(source->text());
+    ast = p->parseProgram();
+    if(ast == nullptr) {
+      std::cout << "Syntax error" << std::endl;
+      for(auto &e : p->errors) {
+        std::cout << fname << ": " << e << std::endl;
+      }
+      return 1;
+    }
+
+    if(caching) {
+      AST::CachedProgram::store(cache, key, AST::FlatTree(ast));
+    }
+  }
+
+  if(options[PARSE]) {
+    std::cout << "Successful parse" << std::endl;
+    return 0;
+  }
+
+  State s;
+  std::string targetError;
+  auto machine = Compiler::hostMachine(targetError);
+
+  AST::PassManager passes;
+  passes.timing = options[TIME_PASSES];
+  passes.addStandard();
+  if(options[SHARE]) {
+    passes.addSharing();
+  }
+
+  // Optimizing invalid IR can crash LLVM, so it's verified first.
+  bool valid = false;
+  passes.add("codegen", [&](AST::Program *program, AST::PassManager &) {
+    program->compile(s);
+    valid = verified(s);
+    return false;
+  });
+  passes.add("optimize", [&](AST::Program *, AST::PassManager &) {
+    if(valid) {
+      Compiler::optimize(*s.Mod, level(options), machine.get());
+    }
+    return false;
+  });
+
+  int status = 1;
+  passes.add(options[RUN] || options[LAZY] ? "run" : "emit", [&](AST::Program *, AST::PassManager &) {
+    if(valid) {
+      status = output(options, s, machine.get(), targetError, fname);
+    }
+    return false;
+  });
+
+  bool ok = passes.run(ast);
+  if(passes.timing) {
+    passes.report(errs());
+  }
+
+  if(!ok) {
+    std::cout << "Semantic error" << std::endl;
+    for(auto &e : passes.errors) {
+      std::cout << fname << ": " << e << std::endl;
+    }
+    return 1;
+  }
+
+  return status;
+}
+
 int main(int argc, char *argv[]) {
   argc -= (argc > 0); argv += (argc>0);
   option::Stats stats(usage, argc, argv);
@@ -59,28 +339,28 @@ int main(int argc, char *argv[]) {
     return 1;
   }
 
-  for(int i = 0; i < parse.nonOptionsCount(); ++i) {
-    std::string fname = parse.nonOption(i);
-    std::ifstream input(fname);
-    if(input) {
-      std::string source( (std::istreambuf_iterator<char>(input)),
-                          (std::istreambuf_iterator<char>() ));
-      Parser p(source);
-      AST::Program *ast = p.parseProgram();
-      if(ast != nullptr) {
-        if(options[PARSE]) {
-          std::cout << "Successful parse" << std::endl;
-          return 0;
-        }
-
-        State s;
-        ast->compile(s);
-      } else {
-        std::cout << "Syntax error" << std::endl;
+  // Streaming compiles each unit as it's read, without the pass manager, so
+  // it can't share, time or cache anything.
+  if(options[STREAM]) {
+    for(auto index : { SHARE, TIME_PASSES, CACHE, CACHE_DIR }) {
+      if(options[index]) {
+        auto opt = options[index].last();
+        std::cout << "Option " << std::string(opt->name, opt->namelen) << " can't be used with --stream" << std::endl;
         return 1;
       }
-    } else {
-      std::cout << "The file " << fname << " could not be read" << std::endl;
+    }
+
+    return stream(options, parse.nonOptionsCount() ? parse.nonOption(0) : "-");
+  }
+
+  if(options[CACHE_DIR]) {
+    mkdir(options[CACHE_DIR].arg, 0777);
+  }
+
+  for(int i = 0; i < parse.nonOptionsCount(); ++i) {
+    auto result = compile(options, parse.nonOption(i));
+    if(result != 0) {
+      return result;
     }
   }
 
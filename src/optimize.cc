@@ -0,0 +1,83 @@
+#include "llvm/Analysis/CGSCCPassManager.h"
+#include "llvm/Analysis/LoopAnalysisManager.h"
+#include "llvm/IR/PassManager.h"
+#include "llvm/MC/SubtargetFeature.h"
+#include "llvm/MC/TargetRegistry.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/TargetSelect.h"
+
+#include "optimize.hh"
+
+using namespace llvm;
+
+namespace Compiler {
+
+std::unique_ptr<TargetMachine> hostMachine(std::string &error) {
+  InitializeNativeTarget();
+  InitializeNativeTargetAsmPrinter();
+  InitializeNativeTargetAsmParser();
+
+  auto triple = sys::getDefaultTargetTriple();
+  auto target = TargetRegistry::lookupTarget(triple, error);
+  if(target == nullptr) {
+    return nullptr;
+  }
+
+  SubtargetFeatures features;
+  StringMap<bool> host;
+  if(sys::getHostCPUFeatures(host)) {
+    for(auto &f : host) {
+      features.AddFeature(f.first(), f.second);
+    }
+  }
+
+  return std::unique_ptr<TargetMachine>(target->createTargetMachine(
+      triple, sys::getHostCPUName(), features.getString(), TargetOptions(), Reloc::PIC_));
+}
+
+bool parseLevel(StringRef arg, OptimizationLevel &level) {
+  if(arg == "0") {
+    level = OptimizationLevel::O0;
+  } else if(arg == "1") {
+    level = OptimizationLevel::O1;
+  } else if(arg == "2") {
+    level = OptimizationLevel::O2;
+  } else if(arg == "3") {
+    level = OptimizationLevel::O3;
+  } else if(arg == "s") {
+    level = OptimizationLevel::Os;
+  } else {
+    return false;
+  }
+
+  return true;
+}
+
+// The analysis managers have to be registered with each other before any of
+// them is used, and destroyed in the reverse order.
+void optimize(Module &m, OptimizationLevel level, TargetMachine *machine) {
+  if(machine != nullptr) {
+    m.setTargetTriple(machine->getTargetTriple().str());
+    m.setDataLayout(machine->createDataLayout());
+    machine->setOptLevel(CodeGenOpt::Level(level.getSpeedupLevel()));
+  }
+
+  LoopAnalysisManager lam;
+  FunctionAnalysisManager fam;
+  CGSCCAnalysisManager cgam;
+  ModuleAnalysisManager mam;
+
+  PassBuilder pb(machine);
+  pb.registerModuleAnalyses(mam);
+  pb.registerCGSCCAnalyses(cgam);
+  pb.registerFunctionAnalyses(fam);
+  pb.registerLoopAnalyses(lam);
+  pb.crossRegisterProxies(lam, fam, cgam, mam);
+
+  auto passes = level == OptimizationLevel::O0 ? pb.buildO0DefaultPipeline(level)
+                                               : pb.buildPerModuleDefaultPipeline(level);
+  passes.run(m, mam);
+}
+
+}
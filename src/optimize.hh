@@ -0,0 +1,25 @@
+#pragma once
+
+#include <memory>
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Passes/OptimizationLevel.h"
+#include "llvm/Target/TargetMachine.h"
+
+namespace Compiler {
+
+// The machine code is generated for, which is always the host for now.
+// Null, with the reason in error, if LLVM wasn't built for it.
+std::unique_ptr<llvm::TargetMachine> hostMachine(std::string &error);
+
+// Reads the argument of -O: 0, 1, 2, 3 or s.
+bool parseLevel(llvm::StringRef arg, llvm::OptimizationLevel &level);
+
+// Runs LLVM's default pipeline for level over the module. Given a machine,
+// the module takes on its triple and data layout first, so the cost models
+// of the vectorizer and unroller see the real target, and the machine is
+// set to generate code at the same level.
+void optimize(llvm::Module &m, llvm::OptimizationLevel level, llvm::TargetMachine *machine);
+
+}
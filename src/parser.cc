@@ -1,10 +1,14 @@
-#include <sstream>
-#include <iostream>
-#include <map>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <thread>
 
 #include "parser.hh"
+#include "stack.hh"
 
-using std::experimental::optional;
+using Lex::Token;
+using Lex::TokenType;
 
 #define OPTION(parser) \
   do { \
@@ -12,385 +16,378 @@ using std::experimental::optional;
     if(ret) { \
       return ret; \
     } \
-  } while(false) 
-
-#define OPTION_MAP(f, parser) \
-  do { \
-    auto ret = f(parser); \
-    if(ret) { \
-      return ret; \
-    } \
   } while(false)
 
-#define PARENS(parser) \
-  (wrap("(", &Parser::parse##parser, ")"))
-
 #define KEYWORD(kw, ret) \
   do { \
-    if(keyword(kw)) { \
+    if(accept(kw)) { \
       return ret; \
     } \
   } while(false);
 
-Parser::Parser(std::string source) {
-  lines = splitLines(source);
-  errors = {};
-  if(lines.size() > 0) {
-    line = lines.begin();
-    column = line->begin();
-  } else {
-    // FIXME: better handling of errors in the constructor. Throwing here is a
-    // hack and should be fixed in the future - though we probably do want to
-    // throw *something* if initialising with an empty string.
-    throw;
-  }
+// Binary operator denoted by each token type, or AST::Invalid.
+static constexpr auto binaryOperators = [] {
+  std::array<AST::BinaryOpType, Lex::EndOfFile + 1> ops = {};
+  for(auto &op : ops) {
+    op = AST::Invalid;
+  }
+
+  ops[Lex::Plus] = AST::Add;
+  ops[Lex::Minus] = AST::Subtract;
+  ops[Lex::Star] = AST::Multiply;
+  ops[Lex::Slash] = AST::Divide;
+  ops[Lex::Percent] = AST::Mod;
+  ops[Lex::Eq] = AST::Eq;
+  ops[Lex::Neq] = AST::Neq;
+  ops[Lex::Gt] = AST::Gt;
+  ops[Lex::Lt] = AST::Lt;
+  ops[Lex::GtEq] = AST::GtEq;
+  ops[Lex::LtEq] = AST::LtEq;
+  ops[Lex::And] = AST::And;
+  ops[Lex::Or] = AST::Or;
+  return ops;
+}();
+
+// Binding strength and operand types of each binary operator, indexed by
+// AST::BinaryOpType.
+const Parser::OperatorInfo Parser::operators[] = {
+  { AdditivePrecedence, false, false },       // Add
+  { AdditivePrecedence, false, false },       // Subtract
+  { MultiplicativePrecedence, false, false }, // Multiply
+  { MultiplicativePrecedence, false, false }, // Divide
+  { MultiplicativePrecedence, false, false }, // Mod
+  { ComparisonPrecedence, false, true },      // Eq
+  { ComparisonPrecedence, false, true },      // Neq
+  { ComparisonPrecedence, false, true },      // Gt
+  { ComparisonPrecedence, false, true },      // Lt
+  { ComparisonPrecedence, false, true },      // GtEq
+  { ComparisonPrecedence, false, true },      // LtEq
+  { AndPrecedence, true, true },              // And
+  { OrPrecedence, true, true }                // Or
+};
+
+Parser::Parser(std::string_view source, bool memoize) :
+  Parser(std::make_unique<Lex::Lexer>(source), memoize)
+{
+}
+
+Parser::Parser(std::unique_ptr<Lex::Lexer> lexer, bool memoize) :
+  tokens(lexer->tokens), lines(lexer->lines),
+  pos(0), threads(0), lexed(std::move(lexer)), memoize(memoize)
+{
+  if(memoize) {
+    memo.resize(PrecedenceCount * tokens.size(), { { nullptr, false }, 0, false });
+  }
+}
+
+// A worker reads the parent's tokens in place. Function bodies are parsed in
+// linear time without the memo table, so workers don't build one.
+Parser::Parser(const Parser &parent) :
+  tokens(parent.tokens), lines(parent.lines),
+  pos(0), threads(1), memoize(false)
+{
 }
 
 AST::Node *Parser::parse() {
   return nullptr;
 }
 
+// The lexer gives magnitudes, so INT32_MIN is in range once it's negated,
+// which is done unsigned. The same literal can be tried by several
+// alternatives, but it's only reported once.
 AST::Literal *Parser::parseLiteral() {
-  skipWhitespace();
-
-  auto base = column;
+  auto prev = mark();
 
-  int multiplier = (*column == '-') ? -1 : 1;
-  if(multiplier == -1) {
-    column++;
-  }
+  bool negative = accept(Lex::Minus);
 
-  std::ostringstream stream;
-  while(std::isdigit(*column)) {
-    stream << *column++;
-  }
+  if(check(Lex::Number)) {
+    uint32_t magnitude = current().value;
+    uint32_t limit = negative ? uint32_t(INT32_MAX) + 1 : INT32_MAX;
+    if(magnitude <= limit) {
+      pos++;
+      return make<AST::Literal>(static_cast<int32_t>(negative ? 0u - magnitude : magnitude));
+    }
 
-  string ret = stream.str();
-  if(ret != "") {
-    return new AST::Literal(multiplier * strtol(ret.c_str(), NULL, 10));
+    auto e = "Integer literal out of range at line " + std::to_string(lines.lineOf(current().offset));
+    if(std::find(errors.begin(), errors.end(), e) == errors.end()) {
+      error(e);
+    }
   }
 
-  column = base;
+  reset(prev);
   return nullptr;
 }
 
 AST::BooleanLiteral *Parser::parseBooleanLiteral() {
-  skipWhitespace();
-
-  KEYWORD("true", new AST::BooleanLiteral(true));
-  KEYWORD("false", new AST::BooleanLiteral(false));
+  KEYWORD(Lex::True, make<AST::BooleanLiteral>(true));
+  KEYWORD(Lex::False, make<AST::BooleanLiteral>(false));
 
   return nullptr;
 }
 
 AST::Variable *Parser::parseVariable() {
-  skipWhitespace();
-
-  if(!(std::isalpha(*column) || *column == '_')) {
-    return nullptr;
-  }
-
-  std::ostringstream stream;
-  while(std::isalnum(*column) || *column == '_') {
-    stream << *column++;
-  }
-
-  if (stream.str() != "") {
-    return new AST::Variable(stream.str());
+  if(check(Lex::Identifier)) {
+    return make<AST::Variable>(Symbol(tokens[pos++].value));
   }
 
   return nullptr;
 }
 
 AST::BinaryOpType Parser::parseOperator() {
-  skipWhitespace();
-
-  std::map<string, AST::BinaryOpType> ops = {
-    { "+", AST::Add },
-    { "-", AST::Subtract },
-    { "*", AST::Multiply },
-    { "/", AST::Divide },
-    { "%", AST::Mod },
-    { "!=", AST::Neq },
-    { "=", AST::Eq },
-    { ">=", AST::GtEq },
-    { "<=", AST::LtEq },
-    { ">", AST::Gt },
-    { "<", AST::Lt },
-    { "and", AST::And },
-    { "or", AST::Or }
-  };
-
-  optional<string> op = longestKeyword(ops);
-  if(op) {
-    keyword(*op);
-    return(ops[*op]);
+  auto op = binaryOperators[current().type];
+  if(op != AST::Invalid) {
+    pos++;
   }
 
-  return AST::Invalid;
+  return op;
 }
 
 AST::UnaryOpType Parser::parseUnaryOperator() {
-  skipWhitespace();
-
-  KEYWORD("not", AST::Not);
+  KEYWORD(Lex::Not, AST::Not);
 
   return AST::UnaryInvalid;
 }
 
 AST::Node *Parser::parseFactor() {
-  skipWhitespace();
-
-  OPTION(Call);
-  OPTION(Literal);
-  OPTION(Variable);
-  OPTION_MAP(PARENS, Expression);
-  OPTION(Deref);
-
-  return nullptr;
+  return typed(PrimaryPrecedence, false);
 }
 
 AST::Node *Parser::parseTerm() {
-  skipWhitespace();
-
-  auto first = parseFactor();
-  auto prev = column;
-  auto op = parseOperator();
-
-  if(op != AST::Invalid) {
-    auto second = parseFactor();
-    auto opValid = (op == AST::Multiply) || (op == AST::Divide) || (op == AST::Mod);
-
-    if(first && second && opValid) {
-      return new AST::BinaryOp(first, op, second);
-    }
-  }
-
-  column = prev;
-  return first;
+  return typed(MultiplicativePrecedence, false);
 }
 
 AST::Node *Parser::parseExpression() {
-  skipWhitespace();
-
-  auto first = parseTerm();
-  auto prev = column;
-  auto op = parseOperator();
-
-  if(op != AST::Invalid) {
-    auto second = parseTerm();
-    auto opValid = (op == AST::Add) || (op == AST::Subtract);
-
-    if(first && second && opValid) {
-      return new AST::BinaryOp(first, op, second);
-    }
-  }
-
-  column = prev;
-  return first;
+  return typed(AdditivePrecedence, false);
 }
 
 AST::Deref *Parser::parseDeref() {
-  auto dr = wrap("[", &Parser::parseExpression, "]");
+  auto dr = wrap(Lex::LeftBracket, &Parser::parseExpression, Lex::RightBracket);
   if(dr) {
-    return new AST::Deref(dr);
+    return make<AST::Deref>(dr);
   }
 
   return nullptr;
 }
 
 AST::Call *Parser::parseCall() {
-  auto prev = column;
+  auto prev = mark();
 
-  AST::Variable *maybeV = parseVariable();
-  if(maybeV == nullptr) {
+  if(!check(Lex::Identifier)) {
     return nullptr;
   }
 
-  if(*column != '(') {
-    column = prev;
+  Symbol name(current().value);
+  pos++;
+
+  if(!accept(Lex::LeftParen)) {
+    reset(prev);
     return nullptr;
   }
 
-  column++;
   auto exprs = parseExpressionList();
-  skipWhitespace();
 
-  if(*column != ')') {
-    column = prev;
+  if(!accept(Lex::RightParen)) {
+    reset(prev);
     return nullptr;
   }
 
-  column++;
-  return new AST::Call(maybeV->name, exprs);
+  return make<AST::Call>(name, arena.copy<AST::Node *>(exprs));
 }
 
 vector<AST::Node *> Parser::parseExpressionList() {
   vector<AST::Node *> vec;
   AST::Node *expr;
 
-  bool comma = false;
-  while(true) {
-    expr = parseExpression();
-    if(expr != nullptr) {
-      vec.push_back(expr);
-    } else if(comma) {
-      column--;
-      break;
-    }
-
-    comma = false;
-    skipWhitespace();
+  auto comma = pos;
+  while((expr = parseExpression())) {
+    vec.push_back(expr);
 
-    if(*column == ',') {
-      comma = true;
-      column++;
-    } else {
-      break;
+    comma = pos;
+    if(!accept(Lex::Comma)) {
+      return vec;
     }
   }
 
+  pos = comma;
   return vec;
 }
 
-vector<string> Parser::parseArgumentList() {
-  vector<string> vec;
-  AST::Variable *expr;
-
-  bool comma = false;
-  while(true) {
-    expr = parseVariable();
-    if(expr != nullptr) {
-      vec.push_back(expr->name);
-    } else if(comma) {
-      column--;
-      break;
-    }
+vector<Symbol> Parser::parseArgumentList() {
+  vector<Symbol> vec;
 
-    comma = false;
-    skipWhitespace();
+  auto comma = pos;
+  while(check(Lex::Identifier)) {
+    vec.push_back(Symbol(tokens[pos++].value));
 
-    if(*column == ',') {
-      comma = true;
-      column++;
-    } else {
-      break;
+    comma = pos;
+    if(!accept(Lex::Comma)) {
+      return vec;
     }
   }
 
+  pos = comma;
   return vec;
 }
 
 AST::BinaryOp *Parser::parseComparison() {
-  auto prev = column;
+  auto prev = mark();
 
   auto left = parseExpression();
   auto op = parseOperator();
-  auto right = parseExpression();
-
-  bool validOp = 
-    (op == AST::Eq) || (op == AST::Neq) ||
-    (op == AST::Lt) || (op == AST::Gt) ||
-    (op == AST::LtEq) || (op == AST::GtEq);
 
-  if(left && right && validOp) {
-    return new AST::BinaryOp(left, op, right);
+  if(left && op != AST::Invalid && operators[op].precedence == ComparisonPrecedence) {
+    auto right = parseExpression();
+    if(right) {
+      return make<AST::BinaryOp>(left, op, right);
+    }
   }
 
-  column = prev;
+  reset(prev);
   return nullptr;
 }
 
 AST::Node *Parser::parseBooleanFactor() {
-  OPTION(Comparison);
-  OPTION(BooleanLiteral);
-  OPTION_MAP(PARENS, Boolean);
-
-  auto op = parseUnaryOperator();
-  auto maybeBool = parseBoolean();
-  if(op != AST::UnaryInvalid && maybeBool) {
-    return new AST::UnaryOp(op, maybeBool);
-  }
-
-  return nullptr;
+  return typed(ComparisonPrecedence, true);
 }
 
 AST::Node *Parser::parseBooleanTerm() {
-  skipWhitespace();
+  return typed(AndPrecedence, true);
+}
 
-  auto first = parseBooleanFactor();
-  auto prev = column;
-  auto op = parseOperator();
+AST::Node *Parser::parseBoolean() {
+  return typed(OrPrecedence, true);
+}
 
-  if(op != AST::Invalid) {
-    auto second = parseBooleanFactor();
-    auto opValid = (op == AST::And);
+Parser::Expr Parser::parseOperand() {
+  if(Stack::low()) {
+    return Stack::fresh([&] { return parseOperand(); });
+  }
+
+  auto prev = mark();
 
-    if(first && second && opValid) {
-      return new AST::BinaryOp(first, op, second);
+  switch(current().type) {
+    case Lex::Number:
+    case Lex::Minus:
+      return { parseLiteral(), false };
+    case Lex::Identifier:
+      if(tokens[pos + 1].type == Lex::LeftParen) {
+        return { parseCall(), false };
+      }
+      return { parseVariable(), false };
+    case Lex::LeftBracket:
+      return { parseDeref(), false };
+    case Lex::True:
+    case Lex::False:
+      return { parseBooleanLiteral(), true };
+    case Lex::Not: {
+      auto op = parseUnaryOperator();
+      auto operand = typed(OrPrecedence, true);
+      if(operand) {
+        return { make<AST::UnaryOp>(op, operand), true };
+      }
+      break;
     }
+    case Lex::LeftParen: {
+      pos++;
+      auto inner = parseBinary(OrPrecedence);
+      if(inner.node && accept(Lex::RightParen)) {
+        return inner;
+      }
+      break;
+    }
+    default:
+      break;
   }
 
-  column = prev;
-  return first;
+  reset(prev);
+  return { nullptr, false };
 }
 
-AST::Node *Parser::parseBoolean() {
-  skipWhitespace();
+Parser::Expr Parser::parseBinary(Precedence min) {
+  if(!memoize) {
+    return climb(min);
+  }
 
-  auto first = parseBooleanTerm();
-  auto prev = column;
-  auto op = parseOperator();
+  auto &entry = memo[min * tokens.size() + pos];
+  if(entry.done) {
+    pos = entry.end;
+    return entry.result;
+  }
 
-  if(op != AST::Invalid) {
-    auto second = parseBooleanTerm();
-    auto opValid = (op == AST::Or);
+  auto result = climb(min);
+  entry = { result, pos, true };
+  return result;
+}
+
+Parser::Expr Parser::climb(Precedence min) {
+  auto left = parseOperand();
+  if(!left.node) {
+    return left;
+  }
 
-    if(first && second && opValid) {
-      return new AST::BinaryOp(first, op, second);
+  while(true) {
+    auto prev = mark();
+    auto op = parseOperator();
+    if(op == AST::Invalid || operators[op].precedence < min) {
+      reset(prev);
+      break;
     }
+
+    auto &info = operators[op];
+    auto right = parseBinary(static_cast<Precedence>(info.precedence + 1));
+
+    bool valid = right.node &&
+      left.boolean == info.booleanOperands &&
+      right.boolean == info.booleanOperands;
+
+    if(!valid) {
+      reset(prev);
+      break;
+    }
+
+    left = { make<AST::BinaryOp>(left.node, op, right.node), info.booleanResult };
+  }
+
+  return left;
+}
+
+AST::Node *Parser::typed(Precedence min, bool boolean) {
+  auto prev = mark();
+
+  auto result = parseBinary(min);
+  if(result.node && result.boolean == boolean) {
+    return result.node;
   }
 
-  column = prev;
-  return first;
+  reset(prev);
+  return nullptr;
 }
 
 AST::Assign *Parser::parseAssign() {
-  auto prev = column;
-  skipWhitespace();
+  auto prev = mark();
 
   AST::Node *loc = parseVariable();
   if(loc == nullptr) {
-    column = prev;
     loc = parseDeref();
   }
 
-  if(loc == nullptr) {
-    column = prev;
-    return nullptr;
-  }
-
-  skipWhitespace();
-
-  if(!isPrefix("<-", column)) {
-    column = prev;
+  if(loc == nullptr || !accept(Lex::Arrow)) {
+    reset(prev);
     return nullptr;
   }
 
-  column += 2;
-  skipWhitespace();
-
   auto maybeExpr = parseExpression();
   if(maybeExpr) {
-    return new AST::Assign(loc, maybeExpr);
+    return make<AST::Assign>(loc, maybeExpr);
   }
 
-  column = prev;
+  reset(prev);
   return nullptr;
 }
 
 AST::Node *Parser::parseStatement() {
   OPTION(Assign);
+  OPTION(Call);
   OPTION(If);
   OPTION(WhileLoop);
   OPTION(Return);
@@ -399,238 +396,306 @@ AST::Node *Parser::parseStatement() {
 }
 
 AST::If *Parser::parseIf() {
-  skipWhitespace();
-  auto prev = column;
+  auto prev = mark();
 
-  if(keyword("if")) {
+  if(accept(Lex::If)) {
     auto maybeB = parseBoolean();
     if(nextLine() && maybeB) {
       auto list = parseStatementList();
-      if(list && keyword("end")) {
-        return new AST::If(maybeB, list, nullptr);
-      } else if(list && keyword("else") && nextLine()) {
+      if(list && accept(Lex::End)) {
+        return make<AST::If>(maybeB, list, nullptr);
+      } else if(list && accept(Lex::Else) && nextLine()) {
         auto falseList = parseStatementList();
-        if(falseList && keyword("end")) {
-          return new AST::If(maybeB, list, falseList);
+        if(falseList && accept(Lex::End)) {
+          return make<AST::If>(maybeB, list, falseList);
         }
       }
     }
   }
 
-  column = prev;
+  reset(prev);
   return nullptr;
 }
 
 AST::WhileLoop *Parser::parseWhileLoop() {
-  skipWhitespace();
-  auto prev = column;
+  auto prev = mark();
 
-  if(keyword("while")) {
+  if(accept(Lex::While)) {
     auto maybeB = parseBoolean();
     if(nextLine() && maybeB) {
       auto list = parseStatementList();
-      if(list && keyword("end")) {
-        return new AST::WhileLoop(maybeB, list);
+      if(list && accept(Lex::End)) {
+        return make<AST::WhileLoop>(maybeB, list);
       }
     }
   }
 
-  column = prev;
+  reset(prev);
   return nullptr;
 }
 
 AST::StatementList *Parser::parseStatementList() {
-  vector<AST::Node *> results;
+  if(Stack::low()) {
+    return Stack::fresh([&] { return parseStatementList(); });
+  }
+
+  auto first = pending.size();
   AST::Node *match;
 
   while((match = matchLine(&Parser::parseStatement))) {
-    results.push_back(match);
+    pending.push_back(match);
   }
 
-  return new AST::StatementList(results);
+  auto list = arena.copy(llvm::makeArrayRef(pending).drop_front(first));
+  pending.resize(first);
+  return make<AST::StatementList>(list);
 }
 
 AST::FunctionDecl *Parser::parseFunctionDeclaration() {
-  auto prev = column;
-  skipWhitespace();
+  auto prev = mark();
 
-  if(keyword("function ")) {
-    skipWhitespace();
-    auto maybeV = parseVariable();
-    if(maybeV && keyword("(")) {
+  if(accept(Lex::Function) && check(Lex::Identifier)) {
+    Symbol name(tokens[pos++].value);
+    if(accept(Lex::LeftParen)) {
       auto list = parseArgumentList();
-      if(keyword(")") && nextLine()) {
+      if(accept(Lex::RightParen) && nextLine()) {
         auto stmts = parseStatementList();
-        if(stmts && keyword("end")) {
-          return new AST::FunctionDecl(maybeV->name, list, stmts);
+        if(stmts && accept(Lex::End)) {
+          return make<AST::FunctionDecl>(name, arena.copy<Symbol>(list), stmts);
         }
       }
     }
   }
 
-  column = prev;
+  reset(prev);
   return nullptr;
 }
 
 AST::FunctionList *Parser::parseFunctionList() {
+  auto ranges = scanFunctions();
+
+  size_t count = 0;
+  for(auto &range : ranges) {
+    count += range.second - range.first;
+  }
+
+  if(threads != 1 && ranges.size() > 1 && count >= parallelTokens) {
+    return make<AST::FunctionList>(arena.copy<AST::Node *>(parseFunctionsParallel(ranges)));
+  }
+
   vector<AST::Node *> results;
   AST::Node *match;
 
   while((match = parseFunctionDeclaration())) {
     nextLine();
-    skipLines();
     results.push_back(match);
   }
 
-  return new AST::FunctionList(results);
+  return make<AST::FunctionList>(arena.copy<AST::Node *>(results));
+}
+
+// Token ranges of the function declarations at the start of the program.
+// Every block opens with function, if or while at the start of a line and
+// closes with end, so a declaration's extent can be found by counting blocks
+// without parsing it.
+vector<std::pair<size_t, size_t>> Parser::scanFunctions() const {
+  vector<std::pair<size_t, size_t>> ranges;
+
+  size_t i = pos;
+  while(tokens[i].type == Lex::Function) {
+    auto begin = i;
+    size_t depth = 0;
+
+    for(; tokens[i].type != Lex::EndOfFile; ++i) {
+      auto type = tokens[i].type;
+      if(type == Lex::Function || type == Lex::If || type == Lex::While) {
+        depth++;
+      } else if(type == Lex::End && --depth == 0) {
+        break;
+      }
+    }
+
+    if(tokens[i].type == Lex::EndOfFile) {
+      break;
+    }
+
+    ranges.emplace_back(begin, ++i);
+    if(tokens[i].type == Lex::Newline) {
+      i++;
+    }
+  }
+
+  return ranges;
+}
+
+vector<std::pair<size_t, size_t>> Parser::topLevelUnits() const {
+  vector<std::pair<size_t, size_t>> ranges;
+
+  size_t i = 0;
+  while(tokens[i].type != Lex::EndOfFile) {
+    auto begin = i;
+    size_t depth = 0;
+
+    for(; tokens[i].type != Lex::EndOfFile; ++i) {
+      auto type = tokens[i].type;
+      if(type == Lex::Function || type == Lex::If || type == Lex::While) {
+        depth++;
+      } else if(type == Lex::End && depth > 0) {
+        depth--;
+      } else if(type == Lex::Newline && depth == 0) {
+        i++;
+        break;
+      }
+    }
+
+    ranges.emplace_back(begin, i);
+  }
+
+  return ranges;
+}
+
+// Parses each range on a pool of workers and keeps the declarations in
+// source order. If one of them doesn't parse, or doesn't span exactly its
+// range, only those before it are kept and the position is left at its
+// start, as a sequential parse would have done.
+vector<AST::Node *> Parser::parseFunctionsParallel(const vector<std::pair<size_t, size_t>> &ranges) {
+  vector<AST::Node *> results(ranges.size(), nullptr);
+  std::atomic<size_t> next(0);
+  std::mutex adopt;
+
+  auto work = [&] {
+    Parser worker(*this);
+    for(size_t i; (i = next++) < ranges.size(); ) {
+      worker.pos = ranges[i].first;
+      auto decl = worker.parseFunctionDeclaration();
+      if(decl && worker.pos == ranges[i].second) {
+        results[i] = decl;
+      }
+    }
+
+    std::lock_guard<std::mutex> lock(adopt);
+    arena.adopt(worker.arena);
+  };
+
+  size_t count = threads ? threads : std::max(1u, std::thread::hardware_concurrency());
+  count = std::min(count, ranges.size());
+
+  vector<std::thread> pool;
+  for(size_t i = 1; i < count; ++i) {
+    pool.emplace_back(work);
+  }
+  work();
+  for(auto &t : pool) {
+    t.join();
+  }
+
+  auto failed = std::find(results.begin(), results.end(), nullptr);
+  if(failed != results.end()) {
+    pos = ranges[failed - results.begin()].first;
+    results.erase(failed, results.end());
+  } else {
+    pos = ranges.back().second;
+    nextLine();
+  }
+
+  return results;
 }
 
 AST::Program *Parser::parseProgram() {
   auto functions = parseFunctionList();
   auto statements = parseStatementList();
-  line++;
 
-  if(line != lines.end()) {
-    error("Failed to parse whole file");
+  if(!check(Lex::EndOfFile)) {
+    error("Failed to parse whole file: stopped at line " +
+          std::to_string(lines.lineOf(current().offset)));
   }
 
   if(errors.size() > 0) {
     return nullptr;
   }
 
-  return new AST::Program(functions, statements);
+  return make<AST::Program>(functions, statements);
 }
 
 AST::Return *Parser::parseReturn() {
-  if(keyword("return")) {
-    skipWhitespace();
+  if(accept(Lex::Return)) {
     auto expr = parseExpression();
 
-    return new AST::Return(expr);
+    return make<AST::Return>(expr);
   }
 
   return nullptr;
 }
 
-template<typename T>
-optional<string> Parser::longestKeyword(std::map<string, T> kws) {
-  size_t max = 0;
-  string maxVal;
-
-  for(const auto& kw : kws) {
-    size_t length = keyword(kw.first, false);
-    if(length > max) {
-      max = length;
-      maxVal = kw.first;
-    }
+template<typename T, typename... Args>
+T *Parser::make(Args &&... args) {
+  return arena.make<T>(std::forward<Args>(args)...);
+}
+
+Parser::Mark Parser::mark() const {
+  return { pos, arena.checkpoint() };
+}
+
+// Nodes allocated since the mark belong to the abandoned alternative, unless
+// they're also held in the memo table.
+void Parser::reset(Mark m) {
+  pos = m.pos;
+  if(!memoize) {
+    arena.rollback(m.arena);
   }
+}
 
-  optional<string> empty {};
-  return max > 0 ? maxVal : empty;
+const Token &Parser::current() const {
+  return tokens[pos];
 }
 
-size_t Parser::keyword(string kw, bool eat) {
-  skipWhitespace();
-  if(isPrefix(kw, column)) {
-    if(eat) { column += kw.length(); }
+bool Parser::check(TokenType type) const {
+  return current().type == type;
+}
 
-    return kw.length();
+bool Parser::accept(TokenType type) {
+  if(check(type)) {
+    pos++;
+    return true;
   }
-  return 0;
+
+  return false;
 }
 
-template<typename T> 
-T *Parser::wrap(string left, T *(Parser::* p)(), string right) {
-  auto prev = column;
-  skipWhitespace();
+template<typename T>
+T *Parser::wrap(TokenType left, T *(Parser::* p)(), TokenType right) {
+  auto prev = mark();
 
-  if(keyword(left)) {
-    skipWhitespace();
+  if(accept(left)) {
     auto maybeT = (this->*p)();
-    skipWhitespace();
-    if(keyword(right) && maybeT) {
+    if(maybeT && accept(right)) {
       return maybeT;
     }
   }
 
-  column = prev;
+  reset(prev);
   return nullptr;
 }
 
 template<typename T>
 T *Parser::matchLine(T *(Parser::* p)()) {
-  auto prev = column;
-  skipWhitespace();
+  auto prev = mark();
 
   T *maybeT;
   if((maybeT = (this->*p)())) {
-    if(column == line->end()) {
-      nextLine();
+    if(check(Lex::EndOfFile) || nextLine()) {
       return maybeT;
     }
   }
 
-  column = prev;
+  reset(prev);
   return nullptr;
 }
 
 bool Parser::nextLine() {
-  if(line != lines.end() - 1) {
-    line++;
-    column = line->begin();
-    return true;
-  }
-
-  return false;
-}
-
-void Parser::skipWhitespace() {
-  while(!nonEmpty(*column)) {
-    column++;
-  }
+  return accept(Lex::Newline);
 }
 
 void Parser::error(string e) {
   errors.push_back(e);
 }
-
-vector<string> Parser::splitLines(string source) {
-  vector<string> ret;
-  std::stringstream stream(source);
-
-  string item;
-  while(std::getline(stream, item)) {
-    item = leftTrim(rightTrim(item));
-    if(item != "") {
-      ret.push_back(item);
-    }
-  }
-
-  return ret;
-}
-
-string &Parser::leftTrim(string &str) {
-  auto it = std::find_if(str.begin(), str.end(), nonEmpty);
-  str.erase(str.begin(), it);
-  return str;
-}
-
-string &Parser::rightTrim(string &str) {
-  auto it = std::find_if(str.rbegin(), str.rend(), nonEmpty);
-  str.erase(it.base(), str.end());
-  return str;
-}
-
-bool Parser::nonEmpty(char ch) {
-  return !std::isspace<char>(ch , std::locale::classic());
-}
-
-bool Parser::isPrefix(string pre, string::iterator source) {
-  return std::equal(pre.begin(), pre.end(), source);
-}
-
-void Parser::skipLines() {
-  while(line->begin() == line->end()) {
-    nextLine();
-  }
-}
@@ -1,24 +1,29 @@
 #pragma once
 
+#include <memory>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
-#include <experimental/optional>
-#include <map>
 
+#include "arena.hh"
 #include "ast.hh"
+#include "lexer.hh"
 
 using std::vector;
 using std::string;
-using std::map;
-using std::experimental::optional;
 
 struct Parser {
-  vector<string> lines;
-  vector<string>::iterator line;
-  string::iterator column;
+  const vector<Lex::Token> &tokens;
+  const Lex::LineIndex &lines;
+  size_t pos;
   vector<string> errors;
 
-  Parser(string source);
+  // Worker threads used to parse function declarations; 0 uses one per core
+  // and 1 parses everything on the calling thread.
+  unsigned threads;
+
+  Parser(std::string_view source, bool memoize = false);
 
   AST::Node *parse();
   AST::Literal *parseLiteral();
@@ -31,7 +36,7 @@ struct Parser {
   AST::Deref *parseDeref();
   AST::Call *parseCall();
   vector<AST::Node *> parseExpressionList();
-  vector<string> parseArgumentList();
+  vector<Symbol> parseArgumentList();
   AST::BinaryOp *parseComparison();
   AST::UnaryOpType parseUnaryOperator();
   AST::Node *parseBooleanFactor();
@@ -46,19 +51,88 @@ struct Parser {
   AST::FunctionList *parseFunctionList();
   AST::Program *parseProgram();
   AST::Return *parseReturn();
+
+  // Token ranges of every top level unit, function declarations and
+  // statements alike, with each range including its trailing newline.
+  vector<std::pair<size_t, size_t>> topLevelUnits() const;
 private:
-  void skipWhitespace();
+  // Owns the tokens, which workers parsing function declarations
+  // share with the parser that started them.
+  std::unique_ptr<Lex::Lexer> lexed;
+
+  // Every node the parser allocates. They live exactly as long as the parser.
+  AST::Arena arena;
+
+  // Statements of the lists being parsed, innermost last, before they're
+  // copied into the arena.
+  vector<AST::Node *> pending;
+
+  // Below this many tokens of function declarations, starting threads costs
+  // more than it saves.
+  static constexpr size_t parallelTokens = 4096;
+
+  Parser(std::unique_ptr<Lex::Lexer> lexer, bool memoize);
+  Parser(const Parser &parent);
+
+  // Operator binding strengths, loosest first. Operands sit above every
+  // binary operator.
+  enum Precedence {
+    OrPrecedence,
+    AndPrecedence,
+    ComparisonPrecedence,
+    AdditivePrecedence,
+    MultiplicativePrecedence,
+    PrimaryPrecedence,
+    PrecedenceCount
+  };
+
+  struct OperatorInfo {
+    Precedence precedence;
+    bool booleanOperands;
+    bool booleanResult;
+  };
+
+  static const OperatorInfo operators[];
+
+  // A parsed expression along with whether it produces a boolean or an
+  // integer, so that mixed operands can be rejected while climbing.
+  struct Expr {
+    AST::Node *node;
+    bool boolean;
+  };
+
+  struct MemoEntry {
+    Expr result;
+    size_t end;
+    bool done;
+  };
+
+  bool memoize;
+  vector<MemoEntry> memo;
+
+  Expr parseOperand();
+  Expr parseBinary(Precedence min);
+  Expr climb(Precedence min);
+  AST::Node *typed(Precedence min, bool boolean);
+
+  vector<std::pair<size_t, size_t>> scanFunctions() const;
+  vector<AST::Node *> parseFunctionsParallel(const vector<std::pair<size_t, size_t>> &ranges);
+
+  // Where a rule started, so that it can backtrack.
+  struct Mark {
+    size_t pos;
+    AST::Arena::Checkpoint arena;
+  };
+
+  template<typename T, typename... Args> T *make(Args &&... args);
+  Mark mark() const;
+  void reset(Mark m);
+
+  const Lex::Token &current() const;
+  bool check(Lex::TokenType type) const;
+  bool accept(Lex::TokenType type);
   bool nextLine();
-  size_t keyword(string kw, bool eat = true);
-  template<typename T> optional<string> longestKeyword(map<string, T> kws);
-  template<typename T> T *wrap(string left, T *(Parser::*)(), string right);
+  template<typename T> T *wrap(Lex::TokenType left, T *(Parser::*)(), Lex::TokenType right);
   template<typename T> T *matchLine(T *(Parser::* p)());
-  void skipLines();
   void error(string);
-
-  static vector<string> splitLines(string source);
-  static string &leftTrim(string &str);
-  static string &rightTrim(string &str);
-  static bool nonEmpty(char ch);
-  static bool isPrefix(string pre, string::iterator source);
 };
@@ -0,0 +1,195 @@
+#include <chrono>
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/Support/Format.h"
+
+#include "fold.hh"
+#include "passes.hh"
+#include "resolve.hh"
+#include "share.hh"
+
+using namespace llvm;
+
+namespace AST {
+
+// Bytes of heap in use, arena blocks included, or 0 where the C library
+// can't say.
+static size_t heapInUse() {
+#ifdef __GLIBC__
+  auto info = mallinfo2();
+  return info.uordblks + info.hblkhd;
+#else
+  return 0;
+#endif
+}
+
+// Walks with a worklist rather than recursing, so deep trees need no stack.
+// Shared nodes are counted once.
+NodeCount::NodeCount(Program *program) : nodes(0) {
+  std::vector<Node *> work{ program };
+  DenseSet<Node *> seen;
+
+  while(!work.empty()) {
+    auto node = work.back();
+    work.pop_back();
+    if(node == nullptr || (node->shared && !seen.insert(node).second)) {
+      continue;
+    }
+
+    ++nodes;
+    switch(node->kind) {
+      case BinaryOpKind: {
+        auto op = cast<BinaryOp>(node);
+        work.push_back(op->left);
+        work.push_back(op->right);
+        break;
+      }
+      case UnaryOpKind:
+        work.push_back(cast<UnaryOp>(node)->operand);
+        break;
+      case DerefKind:
+        work.push_back(cast<Deref>(node)->address);
+        break;
+      case AssignKind: {
+        auto assign = cast<Assign>(node);
+        work.push_back(assign->location);
+        work.push_back(assign->value);
+        break;
+      }
+      case WhileLoopKind: {
+        auto loop = cast<WhileLoop>(node);
+        work.push_back(loop->condition);
+        work.push_back(loop->body);
+        break;
+      }
+      case IfKind: {
+        auto branch = cast<If>(node);
+        work.push_back(branch->condition);
+        work.push_back(branch->trueBody);
+        work.push_back(branch->falseBody);
+        break;
+      }
+      case CallKind: {
+        auto args = cast<Call>(node)->args;
+        work.insert(work.end(), args.begin(), args.end());
+        break;
+      }
+      case ReturnKind:
+        work.push_back(cast<Return>(node)->value);
+        break;
+      case FunctionDeclKind:
+        work.push_back(cast<FunctionDecl>(node)->body);
+        break;
+      case FunctionListKind: {
+        auto functions = cast<FunctionList>(node)->functions;
+        work.insert(work.end(), functions.begin(), functions.end());
+        break;
+      }
+      case StatementListKind: {
+        auto statements = cast<StatementList>(node)->statements;
+        work.insert(work.end(), statements.begin(), statements.end());
+        break;
+      }
+      case ProgramKind: {
+        auto prog = cast<Program>(node);
+        work.push_back(prog->functions);
+        work.push_back(prog->body);
+        break;
+      }
+      default:
+        break;
+    }
+  }
+}
+
+PassManager::PassManager() : timing(false) {}
+
+void PassManager::add(std::string name, Transform run) {
+  passes.push_back({ std::move(name), std::move(run) });
+}
+
+// Resolving fills in slots but leaves the shape of the tree alone. The
+// folder has to live as long as the tree, so the pass keeps it.
+void PassManager::addStandard() {
+  add("resolve", [](Program *program, PassManager &pm) {
+    Resolver resolver;
+    if(!resolver.resolve(program)) {
+      pm.errors.insert(pm.errors.end(), resolver.errors.begin(), resolver.errors.end());
+    }
+    return false;
+  });
+
+  auto folder = std::make_shared<Folder>();
+  add("fold", [folder](Program *program, PassManager &) {
+    auto before = folder->rewrites;
+    folder->fold(program);
+    return folder->rewrites != before;
+  });
+}
+
+void PassManager::addSharing() {
+  auto sharer = std::make_shared<Sharer>();
+  add("share", [sharer](Program *program, PassManager &) {
+    auto before = sharer->shared;
+    sharer->share(program);
+    return sharer->shared != before;
+  });
+}
+
+// Node counts are taken outside the timed region, and are free whenever the
+// previous pass left the tree alone.
+bool PassManager::run(Program *program) {
+  for(auto &pass : passes) {
+    Timing t{ pass.name, 0, 0, 0, 0 };
+    if(timing) {
+      t.nodesBefore = get<NodeCount>(program).nodes;
+    }
+
+    auto errorCount = errors.size();
+    auto heap = timing ? heapInUse() : 0;
+    auto start = std::chrono::steady_clock::now();
+
+    bool changed = pass.run(program, *this);
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    if(changed) {
+      invalidate();
+    }
+
+    if(timing) {
+      t.seconds = elapsed.count();
+      t.bytes = ptrdiff_t(heapInUse()) - ptrdiff_t(heap);
+      t.nodesAfter = get<NodeCount>(program).nodes;
+      timings.push_back(t);
+    }
+
+    if(errors.size() != errorCount) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void PassManager::invalidate() {
+  analyses.clear();
+}
+
+void PassManager::report(raw_ostream &os) const {
+  os << "pass            time (ms)   nodes before    nodes after    heap (KB)\n";
+
+  double total = 0;
+  for(auto &t : timings) {
+    os << format("%-12s %12.3f %14zu %14zu %+12.1f\n", t.name.c_str(), t.seconds * 1e3,
+                 t.nodesBefore, t.nodesAfter, t.bytes / 1024.0);
+    total += t.seconds;
+  }
+
+  os << "total        " << format("%12.3f\n", total * 1e3);
+}
+
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "ast.hh"
+
+namespace AST {
+
+// Distinct nodes reachable from a program, counted once and cached until
+// the tree changes.
+struct NodeCount {
+  size_t nodes;
+
+  NodeCount(Program *program);
+};
+
+// Runs a pipeline of passes over a program, in the order they were added.
+// A transform returns whether it changed the shape of the tree, and if it
+// did every cached analysis is dropped. Analyses are any type constructible
+// from a Program *, computed the first time a pass asks for one through get()
+// and kept until the next invalidation.
+//
+// Passes can keep nodes they make in state captured by their function, so
+// the manager has to outlive the tree it ran over.
+struct PassManager {
+  using Transform = std::function<bool(Program *, PassManager &)>;
+
+  struct Timing {
+    std::string name;
+    double seconds;
+    size_t nodesBefore;
+    size_t nodesAfter;
+
+    // Change in heap in use over the pass, so temporaries freed before it
+    // finishes aren't counted.
+    ptrdiff_t bytes;
+  };
+
+  // Passes report errors here. The pipeline stops after the first pass that
+  // adds any.
+  std::vector<std::string> errors;
+
+  // Filled in by run() when timing is on, one entry per pass that ran.
+  bool timing;
+  std::vector<Timing> timings;
+
+  PassManager();
+
+  void add(std::string name, Transform run);
+
+  // Resolves names, then folds constants.
+  void addStandard();
+
+  // Hash-conses identical expressions. Goes after every other transform.
+  void addSharing();
+
+  // False if a pass reported errors.
+  bool run(Program *program);
+
+  template<typename A>
+  const A &get(Program *program) {
+    auto &result = analyses[key<A>()];
+    if(!result) {
+      result = std::make_unique<Holder<A>>(program);
+    }
+    return static_cast<Holder<A> *>(result.get())->value;
+  }
+
+  void invalidate();
+
+  void report(llvm::raw_ostream &os) const;
+
+private:
+  struct Pass {
+    std::string name;
+    Transform run;
+  };
+
+  struct Result {
+    virtual ~Result() = default;
+  };
+
+  template<typename A>
+  struct Holder : public Result {
+    A value;
+
+    Holder(Program *program) : value(program) {}
+  };
+
+  // Each analysis type is told apart by the address of its own static.
+  template<typename A>
+  static const void *key() {
+    static char id;
+    return &id;
+  }
+
+  std::vector<Pass> passes;
+  llvm::DenseMap<const void *, std::unique_ptr<Result>> analyses;
+};
+
+}
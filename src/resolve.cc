@@ -0,0 +1,212 @@
+#include "resolve.hh"
+#include "stack.hh"
+
+namespace AST {
+
+Resolver::Resolver() :
+  mainSize(0), size(&mainSize), function(nullptr)
+{
+}
+
+uint32_t Resolver::bind(Symbol name) {
+  if(auto b = find(name)) {
+    return b->value;
+  }
+
+  auto slot = (*size)++;
+  names.bind(name, slot);
+  return slot;
+}
+
+const ScopedTable::Binding *Resolver::find(Symbol name) const {
+  auto b = names.lookup(name);
+  return b != nullptr && b->depth == names.depth() ? b : nullptr;
+}
+
+void Resolver::define(FunctionDecl *node) {
+  auto name = node->name.str().str();
+  auto params = node->params.size();
+  auto inserted = signatures.try_emplace(node->name, Signature{params, true});
+  if(inserted.second) {
+    return;
+  }
+
+  auto &sig = inserted.first->second;
+  if(sig.defined) {
+    errors.push_back("Duplicate function " + name);
+  } else if(sig.params != params) {
+    errors.push_back("Function " + name + " takes " + std::to_string(params) + " arguments but is called with " +
+                     std::to_string(sig.params));
+  }
+  sig = Signature{params, true};
+}
+
+std::string Resolver::where() const {
+  return function ? "function " + function->name.str().str() : std::string("top level");
+}
+
+bool Resolver::resolve(Program *program) {
+  auto unit = resolveUnit(program);
+  return finish() && unit;
+}
+
+bool Resolver::resolveUnit(Program *program) {
+  auto before = errors.size();
+  visit(program);
+  return errors.size() == before;
+}
+
+bool Resolver::finish() {
+  auto before = errors.size();
+  for(auto name : called) {
+    if(!signatures.lookup(name).defined) {
+      errors.push_back("Undefined function " + name.str().str());
+    }
+  }
+  called.clear();
+  return errors.size() == before;
+}
+
+bool Resolver::resolveMain(Node *statements) {
+  auto before = errors.size();
+  walk(statements);
+  return errors.size() == before;
+}
+
+void Resolver::walk(Node *node) {
+  if(node == nullptr) {
+    return;
+  }
+
+  if(Stack::low()) {
+    return Stack::run([&] { visit(node); });
+  }
+
+  visit(node);
+}
+
+void Resolver::visitLiteral(Literal *node) {
+}
+
+void Resolver::visitBooleanLiteral(BooleanLiteral *node) {
+}
+
+// An undefined name is bound anyway after it's reported, so that it's only
+// reported once.
+void Resolver::visitVariable(Variable *node) {
+  if(auto b = find(node->name)) {
+    node->slot = b->value;
+    return;
+  }
+
+  errors.push_back("Undefined variable " + node->name.str().str() + " in " + where());
+  node->slot = bind(node->name);
+}
+
+void Resolver::visitBinaryOp(BinaryOp *node) {
+  walk(node->left);
+  walk(node->right);
+}
+
+void Resolver::visitUnaryOp(UnaryOp *node) {
+  walk(node->operand);
+}
+
+void Resolver::visitDeref(Deref *node) {
+  walk(node->address);
+}
+
+// The value is resolved first, so x <- x + 1 doesn't define x.
+void Resolver::visitAssign(Assign *node) {
+  walk(node->value);
+
+  if(auto var = llvm::dyn_cast<Variable>(node->location)) {
+    var->slot = bind(var->name);
+  } else {
+    walk(node->location);
+  }
+}
+
+void Resolver::visitWhileLoop(WhileLoop *node) {
+  walk(node->condition);
+  walk(node->body);
+}
+
+void Resolver::visitIf(If *node) {
+  walk(node->condition);
+  walk(node->trueBody);
+  walk(node->falseBody);
+}
+
+// A function that hasn't been defined yet takes as many arguments as its
+// first call passes.
+void Resolver::visitCall(Call *node) {
+  for(auto arg : node->args) {
+    walk(arg);
+  }
+
+  auto args = node->args.size();
+  auto inserted = signatures.try_emplace(node->name, Signature{args, false});
+  if(inserted.second) {
+    called.push_back(node->name);
+  }
+
+  auto sig = inserted.first->second;
+  if(sig.params != args) {
+    auto verb = sig.defined ? " takes " : " was first called with ";
+    errors.push_back("Function " + node->name.str().str() + verb + std::to_string(sig.params) +
+                     " arguments but is called with " + std::to_string(args) + " in " + where());
+  }
+}
+
+void Resolver::visitReturn(Return *node) {
+  walk(node->value);
+}
+
+void Resolver::visitFunctionDecl(FunctionDecl *node) {
+  uint32_t local = 0;
+  size = &local;
+  function = node;
+  names.push();
+
+  // Parameter i is always slot i, which codegen relies on.
+  for(auto p : node->params) {
+    auto next = local;
+    if(bind(p) != next) {
+      errors.push_back("Duplicate parameter " + p.str().str() + " in function " + node->name.str().str());
+    }
+  }
+
+  walk(node->body);
+  node->slots = local;
+
+  names.pop();
+  size = &mainSize;
+  function = nullptr;
+}
+
+// Every function in the list is defined before any body is resolved, so
+// calls can come before definitions.
+void Resolver::visitFunctionList(FunctionList *node) {
+  for(auto f : node->functions) {
+    define(llvm::cast<FunctionDecl>(f));
+  }
+
+  for(auto f : node->functions) {
+    visit(f);
+  }
+}
+
+void Resolver::visitStatementList(StatementList *node) {
+  for(auto stmt : node->statements) {
+    walk(stmt);
+  }
+}
+
+void Resolver::visitProgram(Program *node) {
+  visit(node->functions);
+  walk(node->body);
+  node->slots = mainSize;
+}
+
+}
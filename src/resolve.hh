@@ -0,0 +1,87 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "llvm/ADT/DenseMap.h"
+
+#include "ast.hh"
+#include "scope.hh"
+
+namespace AST {
+
+// Binds every Variable to a slot in the frame of its function, or of main
+// for top level statements, and records how many slots each frame needs.
+// Parameters take the first slots of their function's frame, and every
+// other name gets the next slot when it's first assigned. A name that's read
+// before anything assigns it, reading down the function, is reported once.
+//
+// A function has to be defined exactly once, and every call has to pass as
+// many arguments as it takes. A call can come before the definition, in a
+// later unit of a stream, in which case the calls are checked against each
+// other until it arrives.
+//
+// Codegen indexes frames by slot rather than looking names up, so a tree has
+// to be resolved before it's compiled.
+struct Resolver : public Visitor<Resolver> {
+  std::vector<std::string> errors;
+
+  Resolver();
+
+  // All return false if there were errors. The main frame carries over
+  // between calls, so the units of a stream can be resolved one after
+  // another with resolveUnit, and finish then reports calls to functions
+  // that were never defined. resolve is both for a whole program.
+  bool resolve(Program *program);
+  bool resolveUnit(Program *program);
+  bool resolveMain(Node *statements);
+  bool finish();
+
+  void visitLiteral(Literal *node);
+  void visitBooleanLiteral(BooleanLiteral *node);
+  void visitVariable(Variable *node);
+  void visitBinaryOp(BinaryOp *node);
+  void visitUnaryOp(UnaryOp *node);
+  void visitDeref(Deref *node);
+  void visitAssign(Assign *node);
+  void visitWhileLoop(WhileLoop *node);
+  void visitIf(If *node);
+  void visitCall(Call *node);
+  void visitReturn(Return *node);
+  void visitFunctionDecl(FunctionDecl *node);
+  void visitFunctionList(FunctionList *node);
+  void visitStatementList(StatementList *node);
+  void visitProgram(Program *node);
+
+private:
+  // Top level names are bound outside every scope, and each function's in a
+  // scope of its own. Only bindings in the innermost scope are visible.
+  ScopedTable names;
+
+  // Arity of each function defined or called so far.
+  struct Signature {
+    size_t params;
+    bool defined;
+  };
+  llvm::DenseMap<Symbol, Signature> signatures;
+
+  // Functions in the order they were first called, to report the undefined
+  // ones in.
+  std::vector<Symbol> called;
+
+  uint32_t mainSize;
+
+  // Size of the frame being resolved.
+  uint32_t *size;
+
+  // Null for top level statements.
+  FunctionDecl *function;
+
+  uint32_t bind(Symbol name);
+  const ScopedTable::Binding *find(Symbol name) const;
+  void define(FunctionDecl *node);
+  std::string where() const;
+  void walk(Node *node);
+};
+
+}
@@ -0,0 +1,90 @@
+#include "scope.hh"
+
+ScopedTable::ScopedTable() :
+  entries(16, { Symbol(empty), { 0, 0 } }), used(0)
+{
+}
+
+void ScopedTable::push() {
+  scopes.push_back(undo.size());
+}
+
+void ScopedTable::pop() {
+  auto mark = scopes.back();
+  scopes.pop_back();
+
+  while(undo.size() > mark) {
+    auto &u = undo.back();
+    auto index = find(u.name);
+    if(u.previous.depth != unbound) {
+      entries[index].binding = u.previous;
+    } else {
+      erase(index);
+    }
+    undo.pop_back();
+  }
+}
+
+uint32_t ScopedTable::depth() const {
+  return scopes.size();
+}
+
+// Nothing is logged for bindings made outside every scope, since they're
+// never popped.
+void ScopedTable::bind(Symbol name, uint32_t value) {
+  auto index = find(name);
+  auto &entry = entries[index];
+
+  if(entry.name == name) {
+    if(entry.binding.depth != depth() && depth() > 0) {
+      undo.push_back({ name, entry.binding });
+    }
+    entry.binding = { value, depth() };
+    return;
+  }
+
+  if(depth() > 0) {
+    undo.push_back({ name, { 0, unbound } });
+  }
+
+  if((used + 1) * 4 > entries.size() * 3) {
+    grow();
+    index = find(name);
+  }
+
+  entries[index] = { name, { value, depth() } };
+  used++;
+}
+
+size_t ScopedTable::size() const {
+  return used;
+}
+
+// Later entries of the same probe run are shifted back into the hole, so
+// lookups never need tombstones.
+void ScopedTable::erase(size_t index) {
+  auto mask = entries.size() - 1;
+  auto hole = index;
+
+  for(auto next = (index + 1) & mask; entries[next].name.id != empty; next = (next + 1) & mask) {
+    auto h = home(entries[next].name);
+    if(((next - h) & mask) >= ((next - hole) & mask)) {
+      entries[hole] = entries[next];
+      hole = next;
+    }
+  }
+
+  entries[hole].name = Symbol(empty);
+  used--;
+}
+
+void ScopedTable::grow() {
+  std::vector<Entry> old(entries.size() * 2, { Symbol(empty), { 0, 0 } });
+  old.swap(entries);
+
+  for(auto &e : old) {
+    if(e.name.id != empty) {
+      entries[find(e.name)] = e;
+    }
+  }
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "symbol.hh"
+
+// Maps symbols to values in nested scopes. Every scope shares one open
+// addressing table holding each name's innermost binding, and binding a name
+// in a new scope records what it shadowed in an undo log. Popping a scope
+// replays the log back to where the scope began, so a lookup is a single
+// probe sequence and opening a scope allocates nothing.
+struct ScopedTable {
+  struct Binding {
+    uint32_t value;
+
+    // Number of scopes open when the name was bound. Bindings made before
+    // any push are at depth 0.
+    uint32_t depth;
+  };
+
+  ScopedTable();
+
+  void push();
+  void pop();
+  uint32_t depth() const;
+
+  // Binds name in the innermost scope, replacing any binding it already has
+  // there.
+  void bind(Symbol name, uint32_t value);
+
+  // The innermost binding of name, or null. The pointer is only valid until
+  // the table next changes.
+  const Binding *lookup(Symbol name) const {
+    auto &entry = entries[find(name)];
+    return entry.name == name ? &entry.binding : nullptr;
+  }
+
+  size_t size() const;
+
+private:
+  struct Entry {
+    Symbol name;
+    Binding binding;
+  };
+
+  // The binding a name had before the scope shadowed it. Its depth is
+  // unbound if the name was new.
+  struct Undo {
+    Symbol name;
+    Binding previous;
+  };
+
+  static constexpr uint32_t empty = UINT32_MAX;
+  static constexpr uint32_t unbound = UINT32_MAX;
+
+  std::vector<Entry> entries;
+  std::vector<Undo> undo;
+  std::vector<size_t> scopes;
+  size_t used;
+
+  // Symbol ids are handed out densely in order of first appearance, so the
+  // names of one function mostly have neighbouring ids, and using the id
+  // itself keeps them in neighbouring entries.
+  size_t home(Symbol name) const {
+    return name.id & (entries.size() - 1);
+  }
+
+  // The entry holding name, or the empty entry where it would go.
+  size_t find(Symbol name) const {
+    auto mask = entries.size() - 1;
+    auto index = home(name);
+    while(entries[index].name.id != empty && entries[index].name != name) {
+      index = (index + 1) & mask;
+    }
+    return index;
+  }
+  void erase(size_t index);
+  void grow();
+};
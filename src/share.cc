@@ -0,0 +1,187 @@
+#include "share.hh"
+#include "stack.hh"
+
+using namespace llvm;
+
+namespace AST {
+
+static uint32_t op(Kind kind, uint32_t type = 0) {
+  return uint32_t(kind) << 8 | type;
+}
+
+Sharer::Sharer() : shared(0), memory(0), writes(0) {}
+
+void Sharer::share(Program *program) {
+  visit(program);
+}
+
+Node *Sharer::walk(Node *node) {
+  if(node == nullptr) {
+    return nullptr;
+  }
+
+  if(Stack::low()) {
+    return Stack::fresh([&] { return visit(node); });
+  }
+
+  return visit(node);
+}
+
+Node *Sharer::intern(Key key, Node *node) {
+  auto result = canonical.try_emplace(key, node);
+  if(result.second) {
+    return node;
+  }
+
+  auto existing = result.first->second;
+  existing->shared = true;
+  ++shared;
+  return existing;
+}
+
+void Sharer::write(uint32_t slot) {
+  if(slot >= versions.size()) {
+    versions.resize(slot + 1, 0);
+  }
+  versions[slot] = ++writes;
+}
+
+void Sharer::region() {
+  canonical.clear();
+}
+
+Node *Sharer::visitLiteral(Literal *node) {
+  return intern({ op(LiteralKind), uint32_t(node->value), 0, nullptr, nullptr }, node);
+}
+
+Node *Sharer::visitBooleanLiteral(BooleanLiteral *node) {
+  return intern({ op(BooleanLiteralKind), node->value, 0, nullptr, nullptr }, node);
+}
+
+Node *Sharer::visitVariable(Variable *node) {
+  auto version = node->slot < versions.size() ? versions[node->slot] : 0;
+  return intern({ op(VariableKind), node->slot, version, nullptr, nullptr }, node);
+}
+
+Node *Sharer::visitBinaryOp(BinaryOp *node) {
+  node->left = walk(node->left);
+  node->right = walk(node->right);
+  return intern({ op(BinaryOpKind, node->type), 0, 0, node->left, node->right }, node);
+}
+
+Node *Sharer::visitUnaryOp(UnaryOp *node) {
+  node->operand = walk(node->operand);
+  return intern({ op(UnaryOpKind, node->type), 0, 0, node->operand, nullptr }, node);
+}
+
+Node *Sharer::visitDeref(Deref *node) {
+  node->address = walk(node->address);
+  return intern({ op(DerefKind), 0, memory, node->address, nullptr }, node);
+}
+
+// Operands are visited in the order codegen evaluates them, and the store
+// happens last.
+Node *Sharer::visitAssign(Assign *node) {
+  auto deref = dyn_cast<Deref>(node->location);
+  if(deref) {
+    deref->address = walk(deref->address);
+  }
+
+  node->value = walk(node->value);
+
+  if(deref) {
+    memory = ++writes;
+  } else {
+    write(cast<Variable>(node->location)->slot);
+  }
+
+  return node;
+}
+
+// The condition is evaluated again after every pass through the body, so
+// it's a region of its own.
+Node *Sharer::visitWhileLoop(WhileLoop *node) {
+  region();
+  node->condition = walk(node->condition);
+  region();
+  node->body = walk(node->body);
+  region();
+  return node;
+}
+
+Node *Sharer::visitIf(If *node) {
+  node->condition = walk(node->condition);
+  region();
+  node->trueBody = walk(node->trueBody);
+  region();
+  node->falseBody = walk(node->falseBody);
+  region();
+  return node;
+}
+
+// Callees can't see the caller's slots, but can write to memory.
+Node *Sharer::visitCall(Call *node) {
+  std::vector<Node *> args;
+  bool changed = false;
+
+  for(size_t i = 0; i < node->args.size(); ++i) {
+    auto arg = node->args[i];
+    auto canon = walk(arg);
+
+    if(canon != arg && !changed) {
+      changed = true;
+      args.assign(node->args.begin(), node->args.begin() + i);
+    }
+
+    if(changed) {
+      args.push_back(canon);
+    }
+  }
+
+  if(changed) {
+    node->args = arena.copy(makeArrayRef(args));
+  }
+
+  memory = ++writes;
+  return node;
+}
+
+Node *Sharer::visitReturn(Return *node) {
+  node->value = walk(node->value);
+  return node;
+}
+
+Node *Sharer::visitFunctionDecl(FunctionDecl *node) {
+  region();
+  versions.clear();
+  node->body = walk(node->body);
+  region();
+  return node;
+}
+
+Node *Sharer::visitFunctionList(FunctionList *node) {
+  for(auto f : node->functions) {
+    visit(f);
+  }
+
+  return node;
+}
+
+Node *Sharer::visitStatementList(StatementList *node) {
+  for(auto stmt : node->statements) {
+    walk(stmt);
+  }
+
+  return node;
+}
+
+Node *Sharer::visitProgram(Program *node) {
+  walk(node->functions);
+  region();
+  versions.clear();
+  walk(node->body);
+  region();
+  return node;
+}
+
+}
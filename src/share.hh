@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Hashing.h"
+
+#include "arena.hh"
+#include "ast.hh"
+
+namespace AST {
+
+// Hash-conses expressions that can't have effects, so that identical ones in
+// the same straight-line region become one node, marked shared. A region
+// ends at the edges of ifs, loops and functions.
+//
+// Two reads are only identical if nothing can have written what they read
+// in between: each slot has a version that moves on whenever it's assigned,
+// and memory has one that moves on with every store to memory and every
+// call. Reads are keyed on those versions, and everything else on the
+// canonical nodes of its operands, so a node that's shared always has the
+// same value wherever it's used. Codegen relies on that to reuse values.
+//
+// The tree becomes a DAG, so this runs after every pass that rewrites nodes
+// in place. Argument lists that change are copied into the sharer's arena,
+// so it has to outlive the tree.
+struct Sharer : public Visitor<Sharer, Node *> {
+  // Expressions replaced by an identical one seen before.
+  size_t shared;
+
+  Sharer();
+
+  void share(Program *program);
+
+  Node *visitLiteral(Literal *node);
+  Node *visitBooleanLiteral(BooleanLiteral *node);
+  Node *visitVariable(Variable *node);
+  Node *visitBinaryOp(BinaryOp *node);
+  Node *visitUnaryOp(UnaryOp *node);
+  Node *visitDeref(Deref *node);
+  Node *visitAssign(Assign *node);
+  Node *visitWhileLoop(WhileLoop *node);
+  Node *visitIf(If *node);
+  Node *visitCall(Call *node);
+  Node *visitReturn(Return *node);
+  Node *visitFunctionDecl(FunctionDecl *node);
+  Node *visitFunctionList(FunctionList *node);
+  Node *visitStatementList(StatementList *node);
+  Node *visitProgram(Program *node);
+
+  // What makes two expressions identical: the kind and operator, a literal
+  // value or slot, the version of what's read, and the canonical operands.
+  struct Key {
+    uint32_t op;
+    uint32_t value;
+    uint32_t version;
+    Node *left;
+    Node *right;
+
+    bool operator==(const Key &other) const {
+      return op == other.op && value == other.value && version == other.version &&
+             left == other.left && right == other.right;
+    }
+  };
+
+private:
+  Arena arena;
+  llvm::DenseMap<Key, Node *> canonical;
+
+  // Version of each slot of the current frame, and of memory, drawn from one
+  // counter so that a version is never reused.
+  std::vector<uint32_t> versions;
+  uint32_t memory;
+  uint32_t writes;
+
+  Node *intern(Key key, Node *node);
+  void write(uint32_t slot);
+  void region();
+  Node *walk(Node *node);
+};
+
+}
+
+namespace llvm {
+
+template<>
+struct DenseMapInfo<AST::Sharer::Key> {
+  static AST::Sharer::Key getEmptyKey() { return { ~0u, 0, 0, nullptr, nullptr }; }
+  static AST::Sharer::Key getTombstoneKey() { return { ~0u - 1, 0, 0, nullptr, nullptr }; }
+
+  static unsigned getHashValue(const AST::Sharer::Key &k) {
+    return hash_combine(k.op, k.value, k.version, k.left, k.right);
+  }
+
+  static bool isEqual(const AST::Sharer::Key &a, const AST::Sharer::Key &b) { return a == b; }
+};
+
+}
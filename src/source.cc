@@ -0,0 +1,47 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "source.hh"
+
+SourceFile::SourceFile(const char *d, size_t s) : data(d), size(s) {}
+
+std::unique_ptr<SourceFile> SourceFile::open(const std::string &path) {
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if(fd < 0) {
+    return nullptr;
+  }
+
+  struct stat st;
+  if(fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+    close(fd);
+    return nullptr;
+  }
+
+  // mmap refuses empty mappings, but an empty file is still a valid source.
+  if(st.st_size == 0) {
+    close(fd);
+    return std::unique_ptr<SourceFile>(new SourceFile(nullptr, 0));
+  }
+
+  void *mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if(mapped == MAP_FAILED) {
+    return nullptr;
+  }
+
+  madvise(mapped, st.st_size, MADV_SEQUENTIAL);
+  return std::unique_ptr<SourceFile>(
+      new SourceFile(static_cast<const char *>(mapped), st.st_size));
+}
+
+std::string_view SourceFile::text() const {
+  return std::string_view(data, size);
+}
+
+SourceFile::~SourceFile() {
+  if(data != nullptr) {
+    munmap(const_cast<char *>(data), size);
+  }
+}
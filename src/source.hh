@@ -0,0 +1,23 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+
+// A source file mapped read-only into memory. The parser works on views into
+// the mapping, so the file contents are never copied.
+struct SourceFile {
+  static std::unique_ptr<SourceFile> open(const std::string &path);
+
+  std::string_view text() const;
+
+  ~SourceFile();
+
+private:
+  const char *data;
+  size_t size;
+
+  SourceFile(const char *d, size_t s);
+  SourceFile(const SourceFile &) = delete;
+  SourceFile &operator=(const SourceFile &) = delete;
+};
@@ -0,0 +1,52 @@
+#include <pthread.h>
+
+#include <cstdio>
+#include <cstdlib>
+
+#include "stack.hh"
+
+namespace Stack {
+
+thread_local uintptr_t limit = 0;
+
+uintptr_t findLimit() {
+  void *base = nullptr;
+  size_t size = 0;
+
+  pthread_attr_t attr;
+  if(pthread_getattr_np(pthread_self(), &attr) == 0) {
+    pthread_attr_getstack(&attr, &base, &size);
+    pthread_attr_destroy(&attr);
+  }
+
+  // Without a known stack, never ask for a new one.
+  if(base == nullptr || size <= reserve) {
+    return 1;
+  }
+
+  return reinterpret_cast<uintptr_t>(base) + reserve;
+}
+
+static void *trampoline(void *f) {
+  (*static_cast<const std::function<void()> *>(f))();
+  return nullptr;
+}
+
+void run(const std::function<void()> &f) {
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  pthread_attr_setstacksize(&attr, segmentSize);
+
+  pthread_t thread;
+  int error = pthread_create(&thread, &attr, trampoline, const_cast<std::function<void()> *>(&f));
+  pthread_attr_destroy(&attr);
+
+  if(error != 0) {
+    std::fprintf(stderr, "Out of memory for nested input\n");
+    std::abort();
+  }
+
+  pthread_join(thread, nullptr);
+}
+
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+// Recursive descent over deeply nested input can need far more stack than a
+// thread has. Recursive functions check Stack::low() on entry, and when it
+// is, carry on in a new thread with a fresh stack while the current one
+// waits. Nesting is then limited by memory rather than by the stack size.
+namespace Stack {
+
+// Stack left, in bytes, when low() starts returning true. Enough for the
+// deepest non-recursive call chain below a checked function, including
+// calls into LLVM.
+static constexpr size_t reserve = 256 * 1024;
+
+// Stack given to each new thread.
+static constexpr size_t segmentSize = 64 * 1024 * 1024;
+
+extern thread_local uintptr_t limit;
+
+uintptr_t findLimit();
+
+inline bool low() {
+  if(limit == 0) {
+    limit = findLimit();
+  }
+
+  return reinterpret_cast<uintptr_t>(__builtin_frame_address(0)) < limit;
+}
+
+// Runs f on a new thread with a fresh stack and waits for it to finish.
+void run(const std::function<void()> &f);
+
+template<typename F>
+auto fresh(F &&f) -> decltype(f()) {
+  decltype(f()) result;
+  run([&] { result = f(); });
+  return result;
+}
+
+}
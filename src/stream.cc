@@ -0,0 +1,221 @@
+#include <thread>
+
+#include "fold.hh"
+#include "resolve.hh"
+#include "stream.hh"
+#include "structure.hh"
+
+UnitReader::UnitReader(std::istream &in) :
+  in(in), lineNumber(0), hasPending(false)
+{
+}
+
+bool UnitReader::read(std::string &source, uint32_t &line) {
+  source.clear();
+
+  size_t depth = 0;
+  bool function = false;
+  std::string text;
+
+  while(hasPending || std::getline(in, text)) {
+    if(hasPending) {
+      text = std::move(pending);
+      hasPending = false;
+    } else {
+      lineNumber++;
+    }
+
+    if(source.empty()) {
+      if(isBlank(text)) {
+        continue;
+      }
+      line = lineNumber;
+    }
+
+    auto word = firstWord(text);
+    if(depth == 0 && word == "function") {
+      // Statements gathered so far go out on their own, so that each
+      // declaration is compiled as soon as it ends.
+      if(!source.empty()) {
+        pending = std::move(text);
+        hasPending = true;
+        return true;
+      }
+      function = true;
+    }
+
+    if(word == "function" || word == "if" || word == "while") {
+      depth++;
+    } else if(word == "end" && depth > 0) {
+      depth--;
+    }
+
+    source += text;
+    source += '\n';
+
+    if(depth == 0 && (function || source.size() >= unitSize)) {
+      return true;
+    }
+  }
+
+  return !source.empty();
+}
+
+std::string_view UnitReader::firstWord(std::string_view line) {
+  size_t begin = 0;
+  while(begin < line.size() && Lex::byteClasses[static_cast<unsigned char>(line[begin])] == Lex::WhitespaceByte) {
+    begin++;
+  }
+
+  size_t end = begin;
+  while(end < line.size() && Lex::byteClasses[static_cast<unsigned char>(line[end])] == Lex::WordByte) {
+    end++;
+  }
+
+  return line.substr(begin, end - begin);
+}
+
+bool UnitReader::isBlank(std::string_view line) {
+  for(char ch : line) {
+    if(Lex::byteClasses[static_cast<unsigned char>(ch)] != Lex::WhitespaceByte) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+Pipeline::Pipeline(std::istream &in) :
+  reader(in), finished(false)
+{
+}
+
+bool Pipeline::parse() {
+  return run(nullptr);
+}
+
+bool Pipeline::compile(Compiler::State &s) {
+  return run(&s);
+}
+
+bool Pipeline::run(Compiler::State *s) {
+  std::thread producer(&Pipeline::produce, this);
+
+  AST::Resolver resolver;
+  bool inMain = false;
+  while(auto unit = take()) {
+    if(s == nullptr) {
+      continue;
+    }
+
+    // The rest of the stream is still drained, so that the producer can
+    // finish, but nothing more is compiled.
+    if(!resolver.resolveUnit(unit->program)) {
+      std::lock_guard<std::mutex> guard(lock);
+      errors.insert(errors.end(), resolver.errors.begin(), resolver.errors.end());
+      s = nullptr;
+      continue;
+    }
+
+    AST::Folder folder;
+    folder.fold(unit->program);
+    unit->program->functions->compile(*s);
+
+    auto body = static_cast<AST::StatementList *>(unit->program->body);
+    if(!body->statements.empty()) {
+      if(!inMain) {
+        s->beginMain();
+        inMain = true;
+      }
+      body->compile(*s);
+    }
+  }
+
+  producer.join();
+
+  // Calls can be to functions defined further down the stream, so they're
+  // only known to be undefined at the end.
+  if(s != nullptr && errors.empty() && !resolver.finish()) {
+    errors.insert(errors.end(), resolver.errors.begin(), resolver.errors.end());
+    s = nullptr;
+  }
+
+  if(errors.size() > 0) {
+    return false;
+  }
+
+  if(s != nullptr) {
+    if(!inMain) {
+      s->beginMain();
+    }
+    s->finishMain();
+  }
+
+  return true;
+}
+
+// The two threads only wake each other when the queue stops being empty or
+// full, so small units are handed over in batches rather than one at a time.
+//
+// Function declarations have to come before every statement, as they do in
+// Parser::parseProgram; a declaration after a statement is reported where
+// the whole-file parse would have stopped.
+void Pipeline::produce() {
+  std::string source;
+  uint32_t line;
+  bool statements = false;
+
+  while(reader.read(source, line)) {
+    auto unit = std::make_unique<Unit>();
+    unit->line = line;
+    unit->parser = std::make_unique<Parser>(source);
+    unit->parser->threads = 1;
+    unit->program = unit->parser->parseProgram();
+
+    auto &p = *unit->parser;
+    uint32_t stopped = 0;
+
+    if(unit->program == nullptr) {
+      stopped = line + p.lines.lineOf(p.tokens[p.pos].offset) - 1;
+    } else {
+      auto functions = static_cast<AST::FunctionList *>(unit->program->functions);
+      auto body = static_cast<AST::StatementList *>(unit->program->body);
+      if(statements && !functions->functions.empty()) {
+        stopped = line;
+      }
+      statements = statements || !body->statements.empty();
+    }
+
+    std::unique_lock<std::mutex> guard(lock);
+    if(stopped != 0) {
+      errors.push_back("Failed to parse whole file: stopped at line " + std::to_string(stopped));
+      break;
+    }
+
+    changed.wait(guard, [&] { return ready.size() < queueDepth; });
+    ready.push_back(std::move(unit));
+    if(ready.size() == 1) {
+      changed.notify_all();
+    }
+  }
+
+  std::lock_guard<std::mutex> guard(lock);
+  finished = true;
+  changed.notify_all();
+}
+
+std::unique_ptr<Unit> Pipeline::take() {
+  std::unique_lock<std::mutex> guard(lock);
+  changed.wait(guard, [&] { return !ready.empty() || finished; });
+
+  if(ready.empty()) {
+    return nullptr;
+  }
+
+  auto unit = std::move(ready.front());
+  ready.pop_front();
+  if(ready.size() == queueDepth - 1) {
+    changed.notify_all();
+  }
+  return unit;
+}
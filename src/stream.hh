@@ -0,0 +1,75 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "ast.hh"
+#include "compiler.hh"
+#include "parser.hh"
+
+// A top level function declaration, or a run of top level statements, parsed
+// on its own. The parser owns the unit's tokens and AST, so both are freed
+// along with it.
+struct Unit {
+  uint32_t line;
+  std::unique_ptr<Parser> parser;
+  AST::Program *program;
+};
+
+// Splits a program read from a stream into top level units. Every block
+// opens with function, if or while at the start of a line and closes with
+// end, so units can be found a line at a time without parsing them.
+struct UnitReader {
+  // Statements are gathered into units of roughly this many bytes.
+  static constexpr size_t unitSize = 64 * 1024;
+
+  UnitReader(std::istream &in);
+
+  // Reads the source of the next unit and the line it starts on. Returns
+  // false once the input is exhausted.
+  bool read(std::string &source, uint32_t &line);
+
+private:
+  std::istream &in;
+  uint32_t lineNumber;
+  std::string pending;
+  bool hasPending;
+
+  static std::string_view firstWord(std::string_view line);
+  static bool isBlank(std::string_view line);
+};
+
+// Parses units on a background thread and compiles each one as soon as it
+// arrives, so memory is bounded by the largest unit rather than the whole
+// program and parsing overlaps with code generation.
+struct Pipeline {
+  // Parsed units allowed to wait for the compiler.
+  static constexpr size_t queueDepth = 16;
+
+  vector<string> errors;
+
+  Pipeline(std::istream &in);
+
+  // Both return false if the input has a syntax error. Units before the
+  // error will already have been compiled.
+  bool parse();
+  bool compile(Compiler::State &s);
+
+private:
+  UnitReader reader;
+
+  std::mutex lock;
+  std::condition_variable changed;
+  std::deque<std::unique_ptr<Unit>> ready;
+  bool finished;
+
+  bool run(Compiler::State *s);
+  void produce();
+  std::unique_ptr<Unit> take();
+};
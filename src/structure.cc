@@ -0,0 +1,185 @@
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define STRUCTURE_X86 1
+#endif
+
+#include "structure.hh"
+
+namespace Lex {
+
+StructuralIndexer::StructuralIndexer() :
+  StructuralIndexer(Scalar)
+{
+#ifdef STRUCTURE_X86
+  if(__builtin_cpu_supports("avx2")) {
+    selected = AVX2;
+    classifier = classifyAVX2;
+  } else if(__builtin_cpu_supports("sse2")) {
+    selected = SSE2;
+    classifier = classifySSE2;
+  }
+#endif
+}
+
+StructuralIndexer::StructuralIndexer(Kernel k) :
+  selected(Scalar), classifier(classifyScalar), previousWord(false)
+{
+#ifdef STRUCTURE_X86
+  if(k == SSE2) {
+    selected = SSE2;
+    classifier = classifySSE2;
+  } else if(k == AVX2) {
+    selected = AVX2;
+    classifier = classifyAVX2;
+  }
+#endif
+}
+
+StructuralIndexer::Kernel StructuralIndexer::kernel() const {
+  return selected;
+}
+
+size_t StructuralIndexer::index(std::string_view source, size_t begin, size_t end,
+                                uint32_t *starts)
+{
+  char padded[blockSize];
+  uint32_t *out = starts;
+
+  for(size_t block = begin; block < end; block += blockSize) {
+    const char *data = source.data() + block;
+
+    // The final partial block is padded with whitespace, which never starts
+    // a token.
+    if(end - block < blockSize) {
+      std::memset(padded, ' ', blockSize);
+      std::memcpy(padded, data, end - block);
+      data = padded;
+    }
+
+    Masks m = classifier(data);
+
+    uint64_t wordStarts = m.word & ~((m.word << 1) | (previousWord ? 1 : 0));
+    uint64_t structural = wordStarts | m.operators | m.newline;
+    previousWord = (m.word >> 63) != 0;
+
+    while(structural != 0) {
+      *out++ = block + __builtin_ctzll(structural);
+      structural &= structural - 1;
+    }
+  }
+
+  return out - starts;
+}
+
+StructuralIndexer::Masks StructuralIndexer::classifyScalar(const char *block) {
+  Masks m = { 0, 0, 0 };
+
+  for(size_t i = 0; i < blockSize; ++i) {
+    uint64_t bit = uint64_t(1) << i;
+    switch(byteClasses[static_cast<unsigned char>(block[i])]) {
+      case WordByte: m.word |= bit; break;
+      case NewlineByte: m.newline |= bit; break;
+      case OperatorByte: m.operators |= bit; break;
+      case WhitespaceByte: break;
+    }
+  }
+
+  return m;
+}
+
+#ifdef STRUCTURE_X86
+
+// Bytes are compared as signed values, so anything at or above 0x80 falls
+// outside every range below and is treated as an operator byte, exactly as
+// classify() does.
+__attribute__((target("sse2")))
+StructuralIndexer::Masks StructuralIndexer::classifySSE2(const char *block) {
+  Masks m = { 0, 0, 0 };
+
+  for(size_t i = 0; i < blockSize; i += 16) {
+    __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(block + i));
+    __m128i lower = _mm_or_si128(c, _mm_set1_epi8(0x20));
+
+    __m128i alpha = _mm_and_si128(
+        _mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+        _mm_cmplt_epi8(lower, _mm_set1_epi8('z' + 1)));
+    __m128i digit = _mm_and_si128(
+        _mm_cmpgt_epi8(c, _mm_set1_epi8('0' - 1)),
+        _mm_cmplt_epi8(c, _mm_set1_epi8('9' + 1)));
+    __m128i word = _mm_or_si128(
+        _mm_or_si128(alpha, digit),
+        _mm_cmpeq_epi8(c, _mm_set1_epi8('_')));
+
+    __m128i newline = _mm_cmpeq_epi8(c, _mm_set1_epi8('\n'));
+    __m128i space = _mm_or_si128(
+        _mm_cmpeq_epi8(c, _mm_set1_epi8(' ')),
+        _mm_and_si128(
+          _mm_cmpgt_epi8(c, _mm_set1_epi8('\t' - 1)),
+          _mm_cmplt_epi8(c, _mm_set1_epi8('\r' + 1))));
+    space = _mm_andnot_si128(newline, space);
+
+    uint64_t w = static_cast<uint16_t>(_mm_movemask_epi8(word));
+    uint64_t n = static_cast<uint16_t>(_mm_movemask_epi8(newline));
+    uint64_t s = static_cast<uint16_t>(_mm_movemask_epi8(space));
+
+    m.word |= w << i;
+    m.newline |= n << i;
+    m.operators |= (~(w | n | s) & 0xffff) << i;
+  }
+
+  return m;
+}
+
+__attribute__((target("avx2")))
+StructuralIndexer::Masks StructuralIndexer::classifyAVX2(const char *block) {
+  Masks m = { 0, 0, 0 };
+
+  for(size_t i = 0; i < blockSize; i += 32) {
+    __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(block + i));
+    __m256i lower = _mm256_or_si256(c, _mm256_set1_epi8(0x20));
+
+    __m256i alpha = _mm256_and_si256(
+        _mm256_cmpgt_epi8(lower, _mm256_set1_epi8('a' - 1)),
+        _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), lower));
+    __m256i digit = _mm256_and_si256(
+        _mm256_cmpgt_epi8(c, _mm256_set1_epi8('0' - 1)),
+        _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), c));
+    __m256i word = _mm256_or_si256(
+        _mm256_or_si256(alpha, digit),
+        _mm256_cmpeq_epi8(c, _mm256_set1_epi8('_')));
+
+    __m256i newline = _mm256_cmpeq_epi8(c, _mm256_set1_epi8('\n'));
+    __m256i space = _mm256_or_si256(
+        _mm256_cmpeq_epi8(c, _mm256_set1_epi8(' ')),
+        _mm256_and_si256(
+          _mm256_cmpgt_epi8(c, _mm256_set1_epi8('\t' - 1)),
+          _mm256_cmpgt_epi8(_mm256_set1_epi8('\r' + 1), c)));
+    space = _mm256_andnot_si256(newline, space);
+
+    uint64_t w = static_cast<uint32_t>(_mm256_movemask_epi8(word));
+    uint64_t n = static_cast<uint32_t>(_mm256_movemask_epi8(newline));
+    uint64_t s = static_cast<uint32_t>(_mm256_movemask_epi8(space));
+
+    m.word |= w << i;
+    m.newline |= n << i;
+    m.operators |= (~(w | n | s) & 0xffffffffull) << i;
+  }
+
+  return m;
+}
+
+#else
+
+StructuralIndexer::Masks StructuralIndexer::classifySSE2(const char *block) {
+  return classifyScalar(block);
+}
+
+StructuralIndexer::Masks StructuralIndexer::classifyAVX2(const char *block) {
+  return classifyScalar(block);
+}
+
+#endif
+
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace Lex {
+
+enum ByteClass : uint8_t {
+  WhitespaceByte,
+  NewlineByte,
+  WordByte,
+  OperatorByte
+};
+
+constexpr ByteClass classify(unsigned char ch) {
+  if(ch == ' ' || ch == '\t' || ch == '\r' || ch == '\v' || ch == '\f') {
+    return WhitespaceByte;
+  }
+  if(ch == '\n') {
+    return NewlineByte;
+  }
+  if((ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') ||
+     (ch >= '0' && ch <= '9') || ch == '_') {
+    return WordByte;
+  }
+  return OperatorByte;
+}
+
+constexpr auto byteClasses = [] {
+  std::array<ByteClass, 256> classes = {};
+  for(size_t ch = 0; ch < classes.size(); ++ch) {
+    classes[ch] = classify(ch);
+  }
+  return classes;
+}();
+
+// Stage one of lexing. Every byte of the source is classified in 64 byte
+// blocks, using SSE2 or AVX2 where the CPU has them, and the offsets at which
+// the lexer has work to do are recorded: the first byte of every word, every
+// operator byte and every newline. Whitespace never reaches the lexer.
+struct StructuralIndexer {
+  static constexpr size_t blockSize = 64;
+
+  enum Kernel {
+    Scalar,
+    SSE2,
+    AVX2
+  };
+
+  // Picks the widest kernel the running CPU supports.
+  StructuralIndexer();
+  StructuralIndexer(Kernel k);
+
+  // Writes the structural offsets of source[begin, end) to starts, which
+  // must have room for end - begin of them, and returns how many there were.
+  // Chunks must be indexed in order, and begin must be a multiple of
+  // blockSize.
+  size_t index(std::string_view source, size_t begin, size_t end,
+               uint32_t *starts);
+
+  Kernel kernel() const;
+
+private:
+  struct Masks {
+    uint64_t word;
+    uint64_t newline;
+    uint64_t operators;
+  };
+
+  typedef Masks (*Classifier)(const char *block);
+
+  Kernel selected;
+  Classifier classifier;
+  bool previousWord;
+
+  static Masks classifyScalar(const char *block);
+  static Masks classifySSE2(const char *block);
+  static Masks classifyAVX2(const char *block);
+};
+
+}
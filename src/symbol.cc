@@ -0,0 +1,65 @@
+#include <atomic>
+#include <mutex>
+
+#include "llvm/ADT/StringMap.h"
+
+#include "symbol.hh"
+
+namespace {
+
+// Names are looked up by id in chunks that double in size and never move, so
+// str() doesn't need the lock. Chunk k holds 2^(k + firstChunkBits) names,
+// starting at id (2^k - 1) * 2^firstChunkBits.
+constexpr unsigned firstChunkBits = 10;
+constexpr unsigned maxChunks = 33 - firstChunkBits;
+
+struct Table {
+  std::mutex lock;
+  llvm::StringMap<uint32_t> ids;
+  std::atomic<llvm::StringRef *> chunks[maxChunks] = {};
+};
+
+Table &table() {
+  static Table t;
+  return t;
+}
+
+struct Slot {
+  unsigned chunk;
+  size_t offset;
+};
+
+Slot locate(uint32_t id) {
+  uint64_t biased = uint64_t(id) + (uint64_t(1) << firstChunkBits);
+  unsigned top = 63 - __builtin_clzll(biased);
+  return { top - firstChunkBits, biased - (uint64_t(1) << top) };
+}
+
+}
+
+Symbol Symbol::intern(std::string_view name) {
+  auto &t = table();
+  std::lock_guard<std::mutex> guard(t.lock);
+
+  auto it = t.ids.try_emplace(llvm::StringRef(name.data(), name.size()), t.ids.size());
+  uint32_t id = it.first->second;
+
+  if(it.second) {
+    auto slot = locate(id);
+    auto chunk = t.chunks[slot.chunk].load(std::memory_order_relaxed);
+    if(chunk == nullptr) {
+      chunk = new llvm::StringRef[size_t(1) << (slot.chunk + firstChunkBits)];
+      t.chunks[slot.chunk].store(chunk, std::memory_order_release);
+    }
+
+    // The map's entries don't move when it grows, so the key can be shared.
+    chunk[slot.offset] = it.first->first();
+  }
+
+  return Symbol(id);
+}
+
+llvm::StringRef Symbol::str() const {
+  auto slot = locate(id);
+  return table().chunks[slot.chunk].load(std::memory_order_acquire)[slot.offset];
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+#include "llvm/ADT/DenseMapInfo.h"
+#include "llvm/ADT/StringRef.h"
+
+// An identifier interned in the process-wide symbol table. The lexer interns
+// every name it sees, and the parser, AST and compiler pass the 32-bit id
+// around from then on, so comparing or hashing a name is an integer
+// operation. The text of each name is stored once and lives until exit.
+//
+// Any thread may intern names. A symbol's text may be read from any thread
+// that was handed the symbol.
+struct Symbol {
+  uint32_t id;
+
+  Symbol() = default;
+  explicit Symbol(uint32_t i) : id(i) {}
+
+  static Symbol intern(std::string_view name);
+
+  llvm::StringRef str() const;
+
+  bool operator==(Symbol other) const { return id == other.id; }
+  bool operator!=(Symbol other) const { return id != other.id; }
+  bool operator<(Symbol other) const { return id < other.id; }
+};
+
+namespace llvm {
+
+template<>
+struct DenseMapInfo<Symbol> {
+  static Symbol getEmptyKey() { return Symbol(~0u); }
+  static Symbol getTombstoneKey() { return Symbol(~0u - 1); }
+  static unsigned getHashValue(Symbol s) { return DenseMapInfo<uint32_t>::getHashValue(s.id); }
+  static bool isEqual(Symbol a, Symbol b) { return a == b; }
+};
+
+}